@@ -27,6 +27,7 @@ namespace dragon
 			m_labelTable.clear();
 			m_disassembly.clear();
 			m_structDefs.clear();
+			m_exports.clear();
 			m_fixedSize = 0;
 			m_fixedFillValue = 0x00;
 			m_loadAddress = 0x0000;
@@ -78,8 +79,7 @@ namespace dragon
 		{
 			assembleFromFile(fileName);
 			if (m_code.size() == 0) return {  };
-			for (i32 i = 0; i < m_code.size(); i++)
-				vhdd.write(address + i, m_code[i]);
+			vhdd.write(address, m_code);
 			return m_code;
 		}
 
@@ -1222,6 +1222,11 @@ namespace dragon
 				m_code.push_back(data::OpCodes::Halt);
 				return;
 			}
+			else if (String(line).toLower().startsWith("wfi"))
+			{
+				m_code.push_back(data::OpCodes::WaitInt);
+				return;
+			}
 		}
 
 		void Assembler::parse1Operand(String line)
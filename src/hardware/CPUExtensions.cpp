@@ -96,6 +96,50 @@ namespace dragon
 				}
 			}
 
+			u8 ExtMov::getInstructionCycles(u8 opCode)
+			{
+				switch (opCode)
+				{
+					case OpCodes::wimm_in_dreg_immoffw:		return 3;
+					case OpCodes::wimm_in_dreg_regoff:		return 3;
+					case OpCodes::wimm_in_dreg_immoffb:		return 3;
+					case OpCodes::bimm_in_dreg_immoffw:		return 3;
+					case OpCodes::bimm_in_dreg_regoff:		return 3;
+					case OpCodes::bimm_in_dreg_immoffb:		return 3;
+					case OpCodes::wdreg_in_dreg_immoffw:	return 4;
+					case OpCodes::wdreg_in_dreg_regoff:		return 4;
+					case OpCodes::wdreg_in_dreg_immoffb:	return 4;
+					case OpCodes::bdreg_in_dreg_immoffw:	return 4;
+					case OpCodes::bdreg_in_dreg_regoff:		return 4;
+					case OpCodes::bdreg_in_dreg_immoffb:	return 4;
+					case OpCodes::wimm_in_mem_immoffw:		return 3;
+					case OpCodes::wimm_in_mem_regoff:		return 3;
+					case OpCodes::wimm_in_mem_immoffb:		return 3;
+					case OpCodes::bimm_in_mem_immoffw:		return 3;
+					case OpCodes::bimm_in_mem_regoff:		return 3;
+					case OpCodes::bimm_in_mem_immoffb:		return 3;
+					case OpCodes::wdreg_immoffw_in_dreg:	return 4;
+					case OpCodes::wdreg_regoff_in_dreg:		return 4;
+					case OpCodes::wdreg_immoffb_in_dreg:	return 4;
+					case OpCodes::bdreg_immoffw_in_dreg:	return 4;
+					case OpCodes::bdreg_regoff_in_dreg:		return 4;
+					case OpCodes::bdreg_immoffb_in_dreg:	return 4;
+					case OpCodes::wmem_immoffw_in_reg:		return 3;
+					case OpCodes::wmem_regoff_in_reg:		return 3;
+					case OpCodes::wmem_immoffb_in_reg:		return 3;
+					case OpCodes::bmem_immoffw_in_reg:		return 3;
+					case OpCodes::bmem_regoff_in_reg:		return 3;
+					case OpCodes::bmem_immoffb_in_reg:		return 3;
+					case OpCodes::wdreg_immoffw_in_reg:		return 3;
+					case OpCodes::wdreg_regoff_in_reg:		return 3;
+					case OpCodes::wdreg_immoffb_in_reg:		return 3;
+					case OpCodes::bdreg_immoffw_in_reg:		return 3;
+					case OpCodes::bdreg_regoff_in_reg:		return 3;
+					case OpCodes::bdreg_immoffb_in_reg:		return 3;
+					default: return 1;
+				}
+			}
+
 			bool ExtMov::execute(VirtualCPU& vcpu)
 			{
 				auto& mem = DragonRuntime::memMap;
@@ -515,6 +559,37 @@ namespace dragon
 				}
 			}
 
+			u8 ExtAlu::getInstructionCycles(u8 opCode)
+			{
+				switch (opCode)
+				{
+					case OpCodes::addipu_reg_in_reg:		return 1;
+					case OpCodes::addipu_imm_in_reg:		return 1;
+					case OpCodes::subipu_reg_in_reg:		return 1;
+					case OpCodes::subipu_imm_in_reg:		return 1;
+					case OpCodes::mulipu_reg_in_reg:		return 3;
+					case OpCodes::mulipu_imm_in_reg:		return 3;
+					case OpCodes::divipu_reg_in_reg:		return 6;
+					case OpCodes::divipu_imm_in_reg:		return 6;
+					case OpCodes::addip_reg_in_reg:			return 1;
+					case OpCodes::addip_imm_in_reg:			return 1;
+					case OpCodes::subip_reg_in_reg:			return 1;
+					case OpCodes::subip_imm_in_reg:			return 1;
+					case OpCodes::mulip_reg_in_reg:			return 3;
+					case OpCodes::mulip_imm_in_reg:			return 3;
+					case OpCodes::divip_reg_in_reg:			return 6;
+					case OpCodes::divip_imm_in_reg:			return 6;
+					case OpCodes::andip_reg_in_reg:			return 1;
+					case OpCodes::andip_imm_in_reg:			return 1;
+					case OpCodes::orip_reg_in_reg:			return 1;
+					case OpCodes::orip_imm_in_reg:			return 1;
+					case OpCodes::xorip_reg_in_reg:			return 1;
+					case OpCodes::xorip_imm_in_reg:			return 1;
+					case OpCodes::notip_reg:				return 1;
+					default: return 1;
+				}
+			}
+
 			bool ExtAlu::execute(VirtualCPU& vcpu)
 			{
 				auto& mem = DragonRuntime::memMap;
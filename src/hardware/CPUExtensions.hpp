@@ -57,6 +57,7 @@ namespace dragon
 					inline ExtMov(void) : data::CPUExtension(data::OpCodes::Ext01, "extmov") {  }
 					String getOpCodeString(u8 opCode) override;
 					u8 getInstructionSIze(u8 opCode) override;
+					u8 getInstructionCycles(u8 opCode) override;
 					bool execute(VirtualCPU& vcpu) override;
 			};
 
@@ -96,6 +97,7 @@ namespace dragon
 					inline ExtAlu(void) : data::CPUExtension(data::OpCodes::Ext02, "extalu") {  }
 					String getOpCodeString(u8 opCode) override;
 					u8 getInstructionSIze(u8 opCode) override;
+					u8 getInstructionCycles(u8 opCode) override;
 					bool execute(VirtualCPU& vcpu) override;
 			};
 		}	
@@ -0,0 +1,195 @@
+#include "DiskBlockCache.hpp"
+#include "../tools/GlobalData.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace dragon
+{
+	namespace hw
+	{
+		void DiskBlockCache::configure(const tConfig& config, IDiskImage& image)
+		{
+			disable();
+			m_config = config;
+			if (m_config.blockSize == 0)
+				m_config.blockSize = tConfig().blockSize;
+			m_maxBlocks = ((u64)m_config.capacityMiB * 1024 * 1024) / m_config.blockSize;
+			if (m_config.readAheadBlocks >= m_maxBlocks)
+				m_config.readAheadBlocks = (m_maxBlocks > 0 ? m_maxBlocks - 1 : 0);
+			m_fileSize = image.getSize();
+			m_image = &image;
+			resetStats();
+		}
+
+		void DiskBlockCache::disable(void)
+		{
+			flush();
+			m_lru.clear();
+			m_blockMap.clear();
+			m_image = nullptr;
+			m_maxBlocks = 0;
+			m_lastMissIndex = 0xFFFFFFFFFFFFFFFF;
+			m_sequentialMisses = 0;
+		}
+
+		bool DiskBlockCache::read(u64 addr, u32 size, i8* outData)
+		{
+			if (!isEnabled()) return false;
+			u64 bs = m_config.blockSize;
+			while (size > 0)
+			{
+				u64 index = addr / bs;
+				u32 offset = addr % bs;
+				u32 chunk = std::min<u64>(bs - offset, size);
+				tBlock* block = __get_block(index, true);
+				if (block == nullptr || offset + chunk > block->data.size())
+					return false;
+				std::memcpy(outData, &block->data[offset], chunk);
+				outData += chunk;
+				addr += chunk;
+				size -= chunk;
+			}
+			return true;
+		}
+
+		bool DiskBlockCache::write(u64 addr, u32 size, const i8* data)
+		{
+			if (!isEnabled()) return false;
+			if (m_config.writePolicy == eWritePolicy::WriteThrough)
+			{
+				if (!m_image->writeBytes(addr, size, data))
+					return false;
+			}
+			u64 bs = m_config.blockSize;
+			while (size > 0)
+			{
+				u64 index = addr / bs;
+				u32 offset = addr % bs;
+				u32 chunk = std::min<u64>(bs - offset, size);
+				tBlock* block = nullptr;
+				if (m_config.writePolicy == eWritePolicy::WriteThrough)
+				{
+					if (m_blockMap.count(index) > 0)
+						block = &(*m_blockMap[index]);
+				}
+				else
+				{
+					block = __get_block(index, true);
+					if (block == nullptr) return false;
+					block->dirty = true;
+				}
+				if (block != nullptr)
+				{
+					if (offset + chunk > block->data.size())
+						return false;
+					std::memcpy(&block->data[offset], data, chunk);
+				}
+				data += chunk;
+				addr += chunk;
+				size -= chunk;
+			}
+			return true;
+		}
+
+		bool DiskBlockCache::flush(void)
+		{
+			if (m_image == nullptr) return true;
+			bool result = true;
+			for (auto& block : m_lru)
+			{
+				if (!block.dirty) continue;
+				if (!__write_block(block))
+					result = false;
+			}
+			if (!m_image->flush())
+				result = false;
+			return result;
+		}
+
+		DiskBlockCache::tBlock* DiskBlockCache::__get_block(u64 index, bool countAccess)
+		{
+			auto it = m_blockMap.find(index);
+			if (it != m_blockMap.end())
+			{
+				if (countAccess)
+					m_stats.hits++;
+				m_lru.splice(m_lru.begin(), m_lru, it->second);
+				return &(*it->second);
+			}
+			if (countAccess)
+			{
+				m_stats.misses++;
+				if (index == m_lastMissIndex + 1 || index == m_lastMissIndex + 1 + m_config.readAheadBlocks)
+					m_sequentialMisses++;
+				else
+					m_sequentialMisses = 0;
+				m_lastMissIndex = index;
+			}
+			tBlock* block = __load_block(index);
+			if (block != nullptr && countAccess && m_sequentialMisses >= SequentialThreshold)
+			{
+				__read_ahead(index);
+				m_lastMissIndex = index;
+			}
+			return block;
+		}
+
+		DiskBlockCache::tBlock* DiskBlockCache::__load_block(u64 index)
+		{
+			u64 start = index * m_config.blockSize;
+			if (start >= m_fileSize) return nullptr;
+			while (m_lru.size() >= m_maxBlocks)
+			{
+				if (!__evict())
+					return nullptr;
+			}
+			tBlock block;
+			block.index = index;
+			block.data.resize(std::min<u64>(m_config.blockSize, m_fileSize - start));
+			if (!m_image->readBytes(start, block.data.size(), &block.data[0]))
+				return nullptr;
+			m_lru.push_front(std::move(block));
+			m_blockMap[index] = m_lru.begin();
+			return &m_lru.front();
+		}
+
+		bool DiskBlockCache::__write_block(tBlock& block)
+		{
+			if (!m_image->writeBytes(block.index * m_config.blockSize, block.data.size(), &block.data[0]))
+				return false;
+			block.dirty = false;
+			m_stats.writeBacks++;
+			return true;
+		}
+
+		bool DiskBlockCache::__evict(void)
+		{
+			if (m_lru.size() == 0) return true;
+			tBlock& victim = m_lru.back();
+			//A dirty block that cannot be written back stays resident (and dirty), so its data is never dropped
+			if (victim.dirty && !__write_block(victim))
+			{
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "Failed to write back an evicted block of the disk cache.");
+				return false;
+			}
+			m_blockMap.erase(victim.index);
+			m_lru.pop_back();
+			m_stats.evictions++;
+			return true;
+		}
+
+		void DiskBlockCache::__read_ahead(u64 index)
+		{
+			u64 lastBlock = __block_count();
+			for (u64 i = index + 1; i <= index + m_config.readAheadBlocks && i < lastBlock; i++)
+			{
+				if (m_blockMap.count(i) > 0) continue;
+				tBlock* block = __load_block(i);
+				if (block == nullptr) return;
+				// Keep the prefetched block behind the one that was actually requested
+				m_lru.splice(std::next(m_lru.begin(), 2), m_lru, m_lru.begin());
+				m_stats.readAheads++;
+			}
+		}
+	}
+}
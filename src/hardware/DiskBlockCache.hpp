@@ -0,0 +1,75 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <unordered_map>
+#include <list>
+#include "DiskImage.hpp"
+
+namespace dragon
+{
+	namespace hw
+	{
+		class DiskBlockCache
+		{
+			public: enum class eWritePolicy { WriteBack = 0, WriteThrough };
+			public: struct tConfig
+			{
+				u32 blockSize { 4096 };
+				u32 capacityMiB { 0 };
+				eWritePolicy writePolicy { eWritePolicy::WriteThrough };
+				u8 readAheadBlocks { 8 };
+			};
+			public: struct tStats
+			{
+				u64 hits { 0 };
+				u64 misses { 0 };
+				u64 evictions { 0 };
+				u64 readAheads { 0 };
+				u64 writeBacks { 0 };
+			};
+
+			public:
+				inline DiskBlockCache(void) {  }
+				void configure(const tConfig& config, IDiskImage& image);
+				void disable(void);
+
+				bool read(u64 addr, u32 size, i8* outData);
+				bool write(u64 addr, u32 size, const i8* data);
+				bool flush(void);
+
+				inline bool isEnabled(void) const { return m_image != nullptr && m_maxBlocks > 0; }
+				inline const tConfig& getConfig(void) const { return m_config; }
+				inline const tStats& getStats(void) const { return m_stats; }
+				inline void resetStats(void) { m_stats = tStats(); }
+
+			private:
+				struct tBlock
+				{
+					u64 index { 0 };
+					ostd::ByteStream data;
+					bool dirty { false };
+				};
+
+				tBlock* __get_block(u64 index, bool countAccess);
+				tBlock* __load_block(u64 index);
+				bool __write_block(tBlock& block);
+				bool __evict(void);
+				void __read_ahead(u64 index);
+				inline u64 __block_count(void) const { return (m_fileSize + m_config.blockSize - 1) / m_config.blockSize; }
+
+			private:
+				tConfig m_config;
+				tStats m_stats;
+				IDiskImage* m_image { nullptr };
+				u64 m_fileSize { 0 };
+				u64 m_maxBlocks { 0 };
+				std::list<tBlock> m_lru;
+				std::unordered_map<u64, std::list<tBlock>::iterator> m_blockMap;
+				u64 m_lastMissIndex { 0xFFFFFFFFFFFFFFFF };
+				u32 m_sequentialMisses { 0 };
+
+				inline static constexpr u32 SequentialThreshold = 2;
+		};
+	}
+}
@@ -0,0 +1,101 @@
+#include "DiskIOEngine.hpp"
+#include "VirtualHardDrive.hpp"
+#include "WakeupSignal.hpp"
+
+namespace dragon
+{
+	namespace hw
+	{
+		void DiskIOEngine::start(u8 workerCount)
+		{
+			stop();
+			m_stopRequested = false;
+			for (u8 i = 0; i < workerCount; i++)
+				m_workers.emplace_back(&DiskIOEngine::__worker_loop, this);
+		}
+
+		void DiskIOEngine::stop(void)
+		{
+			if (m_workers.size() == 0) return;
+			{
+				std::lock_guard<std::mutex> lock(m_pendingLock);
+				m_stopRequested = true;
+			}
+			m_pendingSignal.notify_all();
+			for (auto& worker : m_workers)
+				worker.join();
+			m_workers.clear();
+		}
+
+		u32 DiskIOEngine::submit(tRequest request)
+		{
+			request.id = m_nextRequestID++;
+			if (m_nextRequestID == 0)
+				m_nextRequestID = 1;
+			u32 id = request.id;
+			m_inFlight++;
+			if (!isAsync())
+			{
+				__service_request(request);
+				__complete(request);
+				return id;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_pendingLock);
+				m_pending.push_back(std::move(request));
+			}
+			m_pendingSignal.notify_one();
+			return id;
+		}
+
+		bool DiskIOEngine::pollCompletion(tRequest& outRequest)
+		{
+			if (m_inFlight == 0) return false;
+			std::lock_guard<std::mutex> lock(m_completedLock);
+			if (m_completed.size() == 0) return false;
+			outRequest = std::move(m_completed.front());
+			m_completed.pop_front();
+			m_inFlight--;
+			return true;
+		}
+
+		void DiskIOEngine::__worker_loop(void)
+		{
+			while (true)
+			{
+				tRequest request;
+				{
+					std::unique_lock<std::mutex> lock(m_pendingLock);
+					m_pendingSignal.wait(lock, [this] { return m_stopRequested || m_pending.size() > 0; });
+					if (m_pending.size() == 0) return;
+					request = std::move(m_pending.front());
+					m_pending.pop_front();
+				}
+				__service_request(request);
+				__complete(request);
+			}
+		}
+
+		void DiskIOEngine::__complete(tRequest& request)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_completedLock);
+				m_completed.push_back(std::move(request));
+			}
+			WakeupSignal::notify();
+		}
+
+		void DiskIOEngine::__service_request(tRequest& request)
+		{
+			if (request.disk == nullptr)
+			{
+				request.success = false;
+				return;
+			}
+			if (request.operation == eOperation::Read)
+				request.success = request.disk->read(request.diskAddress, request.size, request.data);
+			else
+				request.success = request.disk->write(request.diskAddress, request.data);
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		class VirtualHardDrive;
+
+		class DiskIOEngine
+		{
+			public: enum class eOperation { Read = 0, Write };
+			public: struct tRequest
+			{
+				u32 id { 0 };
+				VirtualHardDrive* disk { nullptr };
+				eOperation operation { eOperation::Read };
+				u32 diskAddress { 0 };
+				u16 size { 0 };
+				ostd::ByteStream data;
+				bool success { false };
+			};
+
+			public:
+				inline DiskIOEngine(void) {  }
+				inline ~DiskIOEngine(void) { stop(); }
+				DiskIOEngine(const DiskIOEngine&) = delete;
+				DiskIOEngine& operator=(const DiskIOEngine&) = delete;
+
+				void start(u8 workerCount);
+				void stop(void);
+				u32 submit(tRequest request);
+				bool pollCompletion(tRequest& outRequest);
+
+				inline bool isAsync(void) const { return m_workers.size() > 0; }
+				inline u32 getInFlightCount(void) const { return m_inFlight; }
+
+			private:
+				void __worker_loop(void);
+				void __complete(tRequest& request);
+				static void __service_request(tRequest& request);
+
+			private:
+				std::vector<std::thread> m_workers;
+				std::deque<tRequest> m_pending;
+				std::deque<tRequest> m_completed;
+				std::mutex m_pendingLock;
+				std::mutex m_completedLock;
+				std::condition_variable m_pendingSignal;
+				bool m_stopRequested { false };
+				std::atomic<u32> m_inFlight { 0 };
+				u32 m_nextRequestID { 1 };
+		};
+	}
+}
@@ -0,0 +1,454 @@
+#include "DiskImage.hpp"
+#include "../tools/LegacyOstdSerial.hpp"
+#include "../tools/Compression.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <bit>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		RawDiskImage::RawDiskImage(const String& filePath, bool readOnly)
+		{
+			m_readOnly = readOnly;
+			if (readOnly)
+				m_file.open(filePath.cpp_str(), std::ios::in | std::ios::binary);
+			else
+				m_file.open(filePath.cpp_str(), std::ios::out | std::ios::in | std::ios::binary);
+			if (!m_file) return;
+			m_file.seekg(0, std::ios::end);
+			m_size = (u64)m_file.tellg();
+			m_file.seekg(0, std::ios::beg);
+			m_open = true;
+		}
+
+		bool RawDiskImage::readBytes(u64 addr, u32 size, i8* outData)
+		{
+			m_file.seekg(addr);
+			m_file.read((char*)outData, size);
+			if (!m_file)
+			{
+				m_file.clear();
+				return false;
+			}
+			return true;
+		}
+
+		bool RawDiskImage::writeBytes(u64 addr, u32 size, const i8* buffer)
+		{
+			if (m_readOnly) return false;
+			m_file.seekp(addr);
+			m_file.write((const char*)buffer, size);
+			if (!m_file)
+			{
+				m_file.clear();
+				return false;
+			}
+			return true;
+		}
+
+		bool RawDiskImage::flush(void)
+		{
+			if (!m_readOnly)
+				m_file.flush();
+			return (bool)m_file;
+		}
+
+
+
+
+		OverlayDiskImage::OverlayDiskImage(const String& filePath, bool readOnly, u8 chainDepth)
+		{
+			m_readOnly = readOnly;
+			if (readOnly)
+				m_file.open(filePath.cpp_str(), std::ios::in | std::ios::binary);
+			else
+				m_file.open(filePath.cpp_str(), std::ios::out | std::ios::in | std::ios::binary);
+			if (!m_file) return;
+			ostd::ByteStream headerData(tStructure::HeaderSizeBytes);
+			m_file.read((char*)(&headerData[0]), headerData.size());
+			if (!m_file) return;
+			ostd::serial::SerialIO header(headerData);
+			String magic;
+			i16 version = 0;
+			i32 blockSize = 0;
+			i64 diskSize = 0, bitmapOffset = 0, dataOffset = 0;
+			header.r_String(tStructure::Magic, magic, 8);
+			header.r_Word(tStructure::Version, version);
+			header.r_DWord(tStructure::BlockSize, blockSize);
+			header.r_QWord(tStructure::DiskSize, diskSize);
+			header.r_QWord(tStructure::BitmapOffset, bitmapOffset);
+			header.r_QWord(tStructure::DataOffset, dataOffset);
+			header.r_NullTerminatedString(tStructure::BasePath, m_basePath);
+			if (magic != tStructure::MagicString || (u16)version != tStructure::CurrentVersion || blockSize <= 0)
+				return;
+
+			std::filesystem::path basePath(m_basePath.cpp_str());
+			if (basePath.is_relative())
+				basePath = std::filesystem::path(filePath.cpp_str()).parent_path() / basePath;
+			m_base = DiskImageLoader::open(basePath.string(), true, chainDepth + 1);
+			if (m_base == nullptr || m_base->getSize() != (u64)diskSize)
+				return;
+
+			m_size = (u64)diskSize;
+			m_blockSize = (u32)blockSize;
+			m_bitmapOffset = (u64)bitmapOffset;
+			m_dataOffset = (u64)dataOffset;
+			u64 blockCount = (m_size + m_blockSize - 1) / m_blockSize;
+			m_bitmap.resize((blockCount + 7) / 8, 0);
+			if (m_bitmap.size() > 0)
+			{
+				m_file.seekg(m_bitmapOffset);
+				m_file.read((char*)(&m_bitmap[0]), m_bitmap.size());
+				if (!m_file) return;
+			}
+			m_open = true;
+		}
+
+		bool OverlayDiskImage::readBytes(u64 addr, u32 size, i8* outData)
+		{
+			u64 end = addr + size;
+			while (addr < end)
+			{
+				u64 block = addr / m_blockSize;
+				bool allocated = __is_allocated(block);
+				u64 runEnd = (block + 1) * m_blockSize;
+				while (runEnd < end && __is_allocated(runEnd / m_blockSize) == allocated)
+					runEnd += m_blockSize;
+				u32 chunk = (u32)(std::min(runEnd, end) - addr);
+				if (allocated)
+				{
+					m_file.seekg(m_dataOffset + addr);
+					m_file.read((char*)outData, chunk);
+					if (!m_file)
+					{
+						m_file.clear();
+						return false;
+					}
+				}
+				else if (!m_base->readBytes(addr, chunk, outData))
+					return false;
+				outData += chunk;
+				addr += chunk;
+			}
+			return true;
+		}
+
+		bool OverlayDiskImage::writeBytes(u64 addr, u32 size, const i8* buffer)
+		{
+			if (m_readOnly) return false;
+			if (size == 0) return true;
+			u64 end = addr + size;
+			std::vector<u64> newBlocks;
+			for (u64 block = addr / m_blockSize; block * m_blockSize < end; block++)
+			{
+				if (__is_allocated(block)) continue;
+				u64 blockStart = block * m_blockSize;
+				u64 blockEnd = std::min(blockStart + m_blockSize, m_size);
+				bool fullyOverwritten = addr <= blockStart && end >= blockEnd;
+				if (!fullyOverwritten && !__allocate_block(block))
+					return false;
+				newBlocks.push_back(block);
+			}
+			m_file.seekp(m_dataOffset + addr);
+			m_file.write((const char*)buffer, size);
+			if (!m_file)
+			{
+				m_file.clear();
+				return false;
+			}
+			//Blocks are only marked as present once their data is in the overlay, a failed write keeps reading from the base
+			for (u64 block : newBlocks)
+				m_bitmap[block / 8] |= (1 << (block % 8));
+			u64 firstByte = (addr / m_blockSize) / 8;
+			u64 lastByte = ((end - 1) / m_blockSize) / 8;
+			m_file.seekp(m_bitmapOffset + firstByte);
+			m_file.write((const char*)(&m_bitmap[firstByte]), lastByte - firstByte + 1);
+			if (!m_file)
+			{
+				m_file.clear();
+				return false;
+			}
+			return true;
+		}
+
+		bool OverlayDiskImage::flush(void)
+		{
+			if (!m_readOnly)
+				m_file.flush();
+			return (bool)m_file;
+		}
+
+		u64 OverlayDiskImage::getAllocatedBlockCount(void) const
+		{
+			u64 count = 0;
+			for (auto& b : m_bitmap)
+				count += std::popcount((u8)b);
+			return count;
+		}
+
+		bool OverlayDiskImage::__allocate_block(u64 block)
+		{
+			u64 blockStart = block * m_blockSize;
+			ostd::ByteStream data(std::min<u64>(m_blockSize, m_size - blockStart));
+			if (!m_base->readBytes(blockStart, data.size(), &data[0]))
+				return false;
+			m_file.seekp(m_dataOffset + blockStart);
+			m_file.write((const char*)(&data[0]), data.size());
+			if (!m_file)
+			{
+				m_file.clear();
+				return false;
+			}
+			return true;
+		}
+
+		bool OverlayDiskImage::create(const String& filePath, const String& basePath, u32 blockSize)
+		{
+			if (blockSize == 0) return false;
+			auto base = DiskImageLoader::open(basePath, true);
+			if (base == nullptr) return false;
+			std::error_code error;
+			std::filesystem::path overlayDir = std::filesystem::absolute(std::filesystem::path(filePath.cpp_str()), error).parent_path();
+			if (error) return false;
+			std::filesystem::path absoluteBasePath = std::filesystem::absolute(std::filesystem::path(basePath.cpp_str()), error);
+			if (error) return false;
+			std::filesystem::path relativeBasePath = std::filesystem::relative(absoluteBasePath, overlayDir, error);
+			if (error) return false;
+			String storedBasePath = relativeBasePath.string();
+			if (storedBasePath == "" || storedBasePath.len() > tStructure::BasePathMaxLength)
+				return false;
+
+			u64 blockCount = (base->getSize() + blockSize - 1) / blockSize;
+			u64 bitmapSize = (blockCount + 7) / 8;
+			u64 dataOffset = tStructure::HeaderSizeBytes + bitmapSize;
+			dataOffset = ((dataOffset + blockSize - 1) / blockSize) * blockSize;
+
+			ostd::serial::SerialIO header(tStructure::HeaderSizeBytes);
+			header.enableAutoResize(false);
+			header.w_String(tStructure::Magic, tStructure::MagicString, false, false);
+			header.w_Word(tStructure::Version, tStructure::CurrentVersion);
+			header.w_DWord(tStructure::BlockSize, blockSize);
+			header.w_QWord(tStructure::DiskSize, base->getSize());
+			header.w_QWord(tStructure::BitmapOffset, tStructure::HeaderSizeBytes);
+			header.w_QWord(tStructure::DataOffset, dataOffset);
+			header.w_String(tStructure::BasePath, storedBasePath, false, true);
+
+			std::ofstream file(filePath.cpp_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file) return false;
+			ostd::ByteStream bitmap(bitmapSize, 0);
+			file.write((const char*)(&header.getData()[0]), tStructure::HeaderSizeBytes);
+			if (bitmapSize > 0)
+				file.write((const char*)(&bitmap[0]), bitmap.size());
+			return (bool)file;
+		}
+
+		bool OverlayDiskImage::isOverlayFile(const String& filePath)
+		{
+			std::ifstream file(filePath.cpp_str(), std::ios::in | std::ios::binary);
+			if (!file) return false;
+			char magic[8] = { 0 };
+			file.read(magic, sizeof(magic));
+			if (!file) return false;
+			return String(std::string(magic, sizeof(magic))) == tStructure::MagicString;
+		}
+
+
+
+
+		CompressedDiskImage::CompressedDiskImage(const String& filePath)
+		{
+			m_readOnly = true;
+			m_file.open(filePath.cpp_str(), std::ios::in | std::ios::binary);
+			if (!m_file) return;
+			ostd::ByteStream headerData(tStructure::HeaderSizeBytes);
+			m_file.read((char*)(&headerData[0]), headerData.size());
+			if (!m_file) return;
+			ostd::serial::SerialIO header(headerData);
+			String magic;
+			i16 version = 0;
+			i32 blockSize = 0;
+			i64 diskSize = 0, blockCount = 0, indexOffset = 0;
+			header.r_String(tStructure::Magic, magic, 8);
+			header.r_Word(tStructure::Version, version);
+			header.r_DWord(tStructure::BlockSize, blockSize);
+			header.r_QWord(tStructure::DiskSize, diskSize);
+			header.r_QWord(tStructure::BlockCount, blockCount);
+			header.r_QWord(tStructure::IndexOffset, indexOffset);
+			if (magic != tStructure::MagicString || (u16)version != tStructure::CurrentVersion)
+				return;
+			if (blockSize <= 0 || (u32)blockSize > tStructure::MaxBlockSize || blockCount != (diskSize + blockSize - 1) / blockSize)
+				return;
+
+			ostd::ByteStream indexData((u64)blockCount * tStructure::EntrySizeBytes);
+			if (indexData.size() > 0)
+			{
+				m_file.seekg(indexOffset);
+				m_file.read((char*)(&indexData[0]), indexData.size());
+				if (!m_file) return;
+			}
+			ostd::serial::SerialIO index(indexData);
+			m_index.resize(blockCount);
+			for (u64 i = 0; i < (u64)blockCount; i++)
+			{
+				i64 offset = 0;
+				i32 compressedSize = 0;
+				index.r_QWord(i * tStructure::EntrySizeBytes + tStructure::EntryDataOffset, offset);
+				index.r_DWord(i * tStructure::EntrySizeBytes + tStructure::EntryCompressedSize, compressedSize);
+				if ((u32)compressedSize > (u32)blockSize)
+					return;
+				m_index[i] = { (u64)offset, (u32)compressedSize };
+			}
+			m_size = (u64)diskSize;
+			m_blockSize = (u32)blockSize;
+			m_open = true;
+		}
+
+		bool CompressedDiskImage::readBytes(u64 addr, u32 size, i8* outData)
+		{
+			if (addr + size > m_size) return false;
+			while (size > 0)
+			{
+				u64 block = addr / m_blockSize;
+				u32 offset = addr % m_blockSize;
+				u32 chunk = std::min<u32>(m_blockSize - offset, size);
+				const ostd::ByteStream* data = __get_block(block);
+				if (data == nullptr) return false;
+				std::memcpy(outData, &(*data)[offset], chunk);
+				outData += chunk;
+				addr += chunk;
+				size -= chunk;
+			}
+			return true;
+		}
+
+		const ostd::ByteStream* CompressedDiskImage::__get_block(u64 block)
+		{
+			auto it = m_blockCacheMap.find(block);
+			if (it != m_blockCacheMap.end())
+			{
+				m_blockCache.splice(m_blockCache.begin(), m_blockCache, it->second);
+				return &it->second->second;
+			}
+			if (m_blockCache.size() >= tStructure::DecompressedCacheBlocks)
+			{
+				m_blockCacheMap.erase(m_blockCache.back().first);
+				m_blockCache.pop_back();
+			}
+			//Blocks are kept at full size (the tail past the end of the disk stays zero) so readBytes can index freely
+			ostd::ByteStream data(m_blockSize, 0);
+			auto& entry = m_index[block];
+			u32 blockLength = std::min<u64>(m_blockSize, m_size - block * m_blockSize);
+			if (entry.compressedSize > 0)
+			{
+				m_compressedBuffer.resize(entry.compressedSize);
+				m_file.seekg(entry.offset);
+				m_file.read((char*)(&m_compressedBuffer[0]), entry.compressedSize);
+				if (!m_file)
+				{
+					m_file.clear();
+					return nullptr;
+				}
+				if (entry.compressedSize == blockLength)
+					std::memcpy(&data[0], &m_compressedBuffer[0], blockLength);
+				else if (!LZCodec::decompress(&m_compressedBuffer[0], entry.compressedSize, &data[0], blockLength))
+					return nullptr;
+			}
+			m_blockCache.emplace_front(block, std::move(data));
+			m_blockCacheMap[block] = m_blockCache.begin();
+			return &m_blockCache.front().second;
+		}
+
+		bool CompressedDiskImage::create(const String& filePath, IDiskImage& source, u32 blockSize)
+		{
+			if (blockSize == 0 || blockSize > tStructure::MaxBlockSize) return false;
+			std::ofstream file(filePath.cpp_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file) return false;
+			u64 diskSize = source.getSize();
+			u64 blockCount = (diskSize + blockSize - 1) / blockSize;
+			u64 indexOffset = tStructure::HeaderSizeBytes;
+			u64 dataOffset = indexOffset + (blockCount * tStructure::EntrySizeBytes);
+
+			ostd::serial::SerialIO header(tStructure::HeaderSizeBytes);
+			header.enableAutoResize(false);
+			header.w_String(tStructure::Magic, tStructure::MagicString, false, false);
+			header.w_Word(tStructure::Version, tStructure::CurrentVersion);
+			header.w_DWord(tStructure::BlockSize, blockSize);
+			header.w_QWord(tStructure::DiskSize, diskSize);
+			header.w_QWord(tStructure::BlockCount, blockCount);
+			header.w_QWord(tStructure::IndexOffset, indexOffset);
+			ostd::serial::SerialIO index(blockCount * tStructure::EntrySizeBytes);
+			index.enableAutoResize(false);
+
+			//Header and index are written again once the data offsets are known
+			file.write((const char*)(&header.getData()[0]), tStructure::HeaderSizeBytes);
+			if (blockCount > 0)
+				file.write((const char*)(&index.getData()[0]), index.getData().size());
+
+			ostd::ByteStream block(blockSize);
+			ostd::ByteStream compressed;
+			u64 offset = dataOffset;
+			for (u64 i = 0; i < blockCount; i++)
+			{
+				u32 blockLength = std::min<u64>(blockSize, diskSize - i * blockSize);
+				if (!source.readBytes(i * blockSize, blockLength, &block[0]))
+					return false;
+				u32 storedSize = 0;
+				const i8* storedData = &block[0];
+				bool zeroBlock = std::all_of(block.begin(), block.begin() + blockLength, [](i8 b) { return b == 0; });
+				if (!zeroBlock)
+				{
+					storedSize = LZCodec::compress(&block[0], blockLength, compressed);
+					storedData = &compressed[0];
+					if (storedSize >= blockLength)
+					{
+						storedSize = blockLength;
+						storedData = &block[0];
+					}
+					file.write((const char*)storedData, storedSize);
+				}
+				index.w_QWord(i * tStructure::EntrySizeBytes + tStructure::EntryDataOffset, (storedSize > 0 ? offset : 0));
+				index.w_DWord(i * tStructure::EntrySizeBytes + tStructure::EntryCompressedSize, storedSize);
+				offset += storedSize;
+			}
+			if (blockCount > 0)
+			{
+				file.seekp(indexOffset);
+				file.write((const char*)(&index.getData()[0]), index.getData().size());
+			}
+			return (bool)file;
+		}
+
+		bool CompressedDiskImage::isCompressedFile(const String& filePath)
+		{
+			std::ifstream file(filePath.cpp_str(), std::ios::in | std::ios::binary);
+			if (!file) return false;
+			char magic[8] = { 0 };
+			file.read(magic, sizeof(magic));
+			if (!file) return false;
+			return String(std::string(magic, sizeof(magic))) == tStructure::MagicString;
+		}
+
+
+
+
+		std::unique_ptr<IDiskImage> DiskImageLoader::open(const String& filePath, bool readOnly, u8 chainDepth)
+		{
+			if (chainDepth > OverlayDiskImage::tStructure::MaxChainDepth)
+				return nullptr;
+			std::unique_ptr<IDiskImage> image;
+			if (OverlayDiskImage::isOverlayFile(filePath))
+				image = std::make_unique<OverlayDiskImage>(filePath, readOnly, chainDepth);
+			else if (CompressedDiskImage::isCompressedFile(filePath))
+				image = std::make_unique<CompressedDiskImage>(filePath);
+			else
+				image = std::make_unique<RawDiskImage>(filePath, readOnly);
+			if (!image->isOpen())
+				return nullptr;
+			return image;
+		}
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <ostd/string/String.hpp>
+#include <unordered_map>
+#include <fstream>
+#include <memory>
+#include <list>
+
+namespace dragon
+{
+	namespace hw
+	{
+		class IDiskImage
+		{
+			public:
+				virtual ~IDiskImage(void) = default;
+				virtual bool readBytes(u64 addr, u32 size, i8* outData) = 0;
+				virtual bool writeBytes(u64 addr, u32 size, const i8* buffer) = 0;
+				virtual bool flush(void) = 0;
+
+				inline u64 getSize(void) const { return m_size; }
+				inline bool isReadOnly(void) const { return m_readOnly; }
+				inline bool isOpen(void) const { return m_open; }
+
+			protected:
+				u64 m_size { 0 };
+				bool m_readOnly { false };
+				bool m_open { false };
+		};
+
+		class RawDiskImage : public IDiskImage
+		{
+			public:
+				RawDiskImage(const String& filePath, bool readOnly);
+				bool readBytes(u64 addr, u32 size, i8* outData) override;
+				bool writeBytes(u64 addr, u32 size, const i8* buffer) override;
+				bool flush(void) override;
+
+			private:
+				std::fstream m_file;
+		};
+
+		class OverlayDiskImage : public IDiskImage
+		{
+			public: struct tStructure
+			{
+				inline static constexpr u16 Magic								= 0x000;
+				inline static constexpr u16 Version								= 0x008;
+				inline static constexpr u16 BlockSize							= 0x00C;
+				inline static constexpr u16 DiskSize							= 0x010;
+				inline static constexpr u16 BitmapOffset						= 0x018;
+				inline static constexpr u16 DataOffset							= 0x020;
+				inline static constexpr u16 BasePath							= 0x040;
+
+				inline static constexpr u16 HeaderSizeBytes						= 0x200;
+				inline static constexpr u16 BasePathMaxLength					= HeaderSizeBytes - BasePath - 1;
+				inline static constexpr u16 CurrentVersion						= 0x0001;
+				inline static constexpr u32 DefaultBlockSize					= 4096;
+				inline static constexpr u8 MaxChainDepth						= 16;
+				inline static constexpr const char* MagicString				= "DVMOVRLY";
+			};
+
+			public:
+				OverlayDiskImage(const String& filePath, bool readOnly, u8 chainDepth);
+				bool readBytes(u64 addr, u32 size, i8* outData) override;
+				bool writeBytes(u64 addr, u32 size, const i8* buffer) override;
+				bool flush(void) override;
+
+				inline const String& getBasePath(void) const { return m_basePath; }
+				inline u32 getBlockSize(void) const { return m_blockSize; }
+				u64 getAllocatedBlockCount(void) const;
+
+				static bool create(const String& filePath, const String& basePath, u32 blockSize = tStructure::DefaultBlockSize);
+				static bool isOverlayFile(const String& filePath);
+
+			private:
+				inline bool __is_allocated(u64 block) const { return (m_bitmap[block / 8] >> (block % 8)) & 1; }
+				bool __allocate_block(u64 block);
+
+			private:
+				std::fstream m_file;
+				std::unique_ptr<IDiskImage> m_base;
+				String m_basePath;
+				ostd::ByteStream m_bitmap;
+				u32 m_blockSize { 0 };
+				u64 m_bitmapOffset { 0 };
+				u64 m_dataOffset { 0 };
+		};
+
+		class CompressedDiskImage : public IDiskImage
+		{
+			public: struct tStructure
+			{
+				inline static constexpr u16 Magic								= 0x000;
+				inline static constexpr u16 Version								= 0x008;
+				inline static constexpr u16 BlockSize							= 0x00C;
+				inline static constexpr u16 DiskSize							= 0x010;
+				inline static constexpr u16 BlockCount							= 0x018;
+				inline static constexpr u16 IndexOffset							= 0x020;
+
+				inline static constexpr u16 EntryDataOffset						= 0x000;
+				inline static constexpr u16 EntryCompressedSize					= 0x008;
+
+				inline static constexpr u16 HeaderSizeBytes						= 0x040;
+				inline static constexpr u16 EntrySizeBytes						= 12;
+				inline static constexpr u16 CurrentVersion						= 0x0001;
+				inline static constexpr u32 DefaultBlockSize					= 16384;
+				inline static constexpr u32 MaxBlockSize						= 0x100000;
+				inline static constexpr u32 DecompressedCacheBlocks				= 64;
+				inline static constexpr const char* MagicString				= "DVMCMPRS";
+			};
+
+			public:
+				CompressedDiskImage(const String& filePath);
+				bool readBytes(u64 addr, u32 size, i8* outData) override;
+				inline bool writeBytes(u64 addr, u32 size, const i8* buffer) override { return false; }
+				inline bool flush(void) override { return true; }
+
+				inline u32 getBlockSize(void) const { return m_blockSize; }
+
+				static bool create(const String& filePath, IDiskImage& source, u32 blockSize = tStructure::DefaultBlockSize);
+				static bool isCompressedFile(const String& filePath);
+
+			private:
+				struct tIndexEntry
+				{
+					u64 offset { 0 };
+					u32 compressedSize { 0 };
+				};
+
+				const ostd::ByteStream* __get_block(u64 block);
+
+			private:
+				std::ifstream m_file;
+				u32 m_blockSize { 0 };
+				std::vector<tIndexEntry> m_index;
+				ostd::ByteStream m_compressedBuffer;
+				std::list<std::pair<u64, ostd::ByteStream>> m_blockCache;
+				std::unordered_map<u64, std::list<std::pair<u64, ostd::ByteStream>>::iterator> m_blockCacheMap;
+		};
+
+		class DiskImageLoader
+		{
+			public:
+				static std::unique_ptr<IDiskImage> open(const String& filePath, bool readOnly = false, u8 chainDepth = 0);
+		};
+	}
+}
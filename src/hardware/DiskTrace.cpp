@@ -0,0 +1,156 @@
+#include "DiskTrace.hpp"
+#include "../tools/LegacyOstdSerial.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace dragon
+{
+	namespace hw
+	{
+		void DiskIOStats::addSample(bool write, u32 size, bool success, u64 cycles, u64 wallTimeNs)
+		{
+			m_requests++;
+			if (!success)
+				m_failed++;
+			if (write)
+			{
+				m_writes++;
+				if (success) m_bytesWritten += size;
+			}
+			else
+			{
+				m_reads++;
+				if (success) m_bytesRead += size;
+			}
+			m_totalCycles += cycles;
+			m_totalWallTimeNs += wallTimeNs;
+			m_cycleBuckets[__bucket(cycles)]++;
+			m_wallTimeBuckets[__bucket(wallTimeNs)]++;
+		}
+
+		u8 DiskIOStats::__bucket(u64 value)
+		{
+			if (value == 0) return 0;
+			return std::min<u8>(std::bit_width(value), BucketCount - 1);
+		}
+
+		u64 DiskIOStats::__percentile(const u64 (&buckets)[BucketCount], f64 percentile) const
+		{
+			if (m_requests == 0) return 0;
+			u64 target = (u64)(percentile * m_requests);
+			if (target == 0) target = 1;
+			u64 count = 0;
+			for (u8 i = 0; i < BucketCount; i++)
+			{
+				count += buckets[i];
+				if (count >= target)
+					return i == 0 ? 0 : (1ULL << i) - 1;
+			}
+			return 0xFFFFFFFFFFFFFFFF;
+		}
+
+
+
+		bool DiskTraceFile::open(const String& filePath)
+		{
+			close();
+			m_file.open(filePath.cpp_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!m_file) return false;
+			ostd::serial::SerialIO header(tStructure::HeaderSizeBytes);
+			header.enableAutoResize(false);
+			header.w_String(tStructure::Magic, tStructure::MagicString, false, false);
+			header.w_Word(tStructure::Version, tStructure::CurrentVersion);
+			m_file.write((const char*)(&header.getData()[0]), tStructure::HeaderSizeBytes);
+			m_buffer.reserve(tStructure::FlushThresholdRecords * tStructure::RecordSizeBytes);
+			return (bool)m_file;
+		}
+
+		void DiskTraceFile::close(void)
+		{
+			if (!m_file.is_open()) return;
+			__flush();
+			m_file.close();
+		}
+
+		void DiskTraceFile::record(const tRecord& record)
+		{
+			if (!m_file.is_open()) return;
+			ostd::serial::SerialIO data(tStructure::RecordSizeBytes);
+			data.enableAutoResize(false);
+			data.w_Byte(tStructure::RecordDisk, record.disk);
+			data.w_Byte(tStructure::RecordMode, record.write ? 1 : 0);
+			data.w_Byte(tStructure::RecordSuccess, record.success ? 1 : 0);
+			data.w_Byte(tStructure::RecordSource, record.source);
+			data.w_DWord(tStructure::RecordAddress, record.address);
+			data.w_Word(tStructure::RecordSize, record.size);
+			data.w_QWord(tStructure::RecordStartCycle, record.startCycle);
+			data.w_QWord(tStructure::RecordEndCycle, record.endCycle);
+			data.w_QWord(tStructure::RecordWallTimeNs, record.wallTimeNs);
+			m_buffer.insert(m_buffer.end(), data.getData().begin(), data.getData().end());
+			if (++m_bufferedRecords >= tStructure::FlushThresholdRecords)
+				__flush();
+		}
+
+		bool DiskTraceFile::load(const String& filePath, std::vector<tRecord>& outRecords)
+		{
+			outRecords.clear();
+			std::ifstream file(filePath.cpp_str(), std::ios::in | std::ios::binary | std::ios::ate);
+			if (!file) return false;
+			u64 fileSize = file.tellg();
+			if (fileSize < tStructure::HeaderSizeBytes) return false;
+			file.seekg(0);
+			ostd::ByteStream fileData(fileSize);
+			file.read((char*)(&fileData[0]), fileSize);
+			if (!file) return false;
+
+			ostd::serial::SerialIO data(fileData);
+			String magic;
+			i16 version = 0;
+			data.r_String(tStructure::Magic, magic, 8);
+			data.r_Word(tStructure::Version, version);
+			if (magic != tStructure::MagicString || (u16)version != tStructure::CurrentVersion)
+				return false;
+
+			u64 recordCount = (fileSize - tStructure::HeaderSizeBytes) / tStructure::RecordSizeBytes;
+			outRecords.reserve(recordCount);
+			i8 outData8 = 0;
+			i16 outData16 = 0;
+			i32 outData32 = 0;
+			i64 outData64 = 0;
+			for (u64 i = 0; i < recordCount; i++)
+			{
+				u64 addr = tStructure::HeaderSizeBytes + (i * tStructure::RecordSizeBytes);
+				tRecord record;
+				data.r_Byte(addr + tStructure::RecordDisk, outData8);
+				record.disk = (u8)outData8;
+				data.r_Byte(addr + tStructure::RecordMode, outData8);
+				record.write = outData8 != 0;
+				data.r_Byte(addr + tStructure::RecordSuccess, outData8);
+				record.success = outData8 != 0;
+				data.r_Byte(addr + tStructure::RecordSource, outData8);
+				record.source = (u8)outData8;
+				data.r_DWord(addr + tStructure::RecordAddress, outData32);
+				record.address = (u32)outData32;
+				data.r_Word(addr + tStructure::RecordSize, outData16);
+				record.size = (u16)outData16;
+				data.r_QWord(addr + tStructure::RecordStartCycle, outData64);
+				record.startCycle = (u64)outData64;
+				data.r_QWord(addr + tStructure::RecordEndCycle, outData64);
+				record.endCycle = (u64)outData64;
+				data.r_QWord(addr + tStructure::RecordWallTimeNs, outData64);
+				record.wallTimeNs = (u64)outData64;
+				outRecords.push_back(record);
+			}
+			return true;
+		}
+
+		void DiskTraceFile::__flush(void)
+		{
+			if (m_buffer.size() > 0)
+				m_file.write((const char*)(&m_buffer[0]), m_buffer.size());
+			m_file.flush();
+			m_buffer.clear();
+			m_bufferedRecords = 0;
+		}
+	}
+}
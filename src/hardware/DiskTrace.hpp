@@ -0,0 +1,111 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <fstream>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		class DiskIOStats
+		{
+			public:
+				inline DiskIOStats(void) {  }
+				void addSample(bool write, u32 size, bool success, u64 cycles, u64 wallTimeNs);
+
+				inline u64 getRequestCount(void) const { return m_requests; }
+				inline u64 getReadCount(void) const { return m_reads; }
+				inline u64 getWriteCount(void) const { return m_writes; }
+				inline u64 getFailedCount(void) const { return m_failed; }
+				inline u64 getBytesRead(void) const { return m_bytesRead; }
+				inline u64 getBytesWritten(void) const { return m_bytesWritten; }
+				inline f64 getAverageCycles(void) const { return m_requests == 0 ? 0.0 : (f64)m_totalCycles / m_requests; }
+				inline f64 getAverageWallTimeNs(void) const { return m_requests == 0 ? 0.0 : (f64)m_totalWallTimeNs / m_requests; }
+				inline u64 getP99Cycles(void) const { return __percentile(m_cycleBuckets, 0.99); }
+				inline u64 getP99WallTimeNs(void) const { return __percentile(m_wallTimeBuckets, 0.99); }
+
+			private:
+				//Power of two buckets: percentiles are reported as the upper bound of the bucket they fall in
+				inline static constexpr u8 BucketCount = 64;
+				static u8 __bucket(u64 value);
+				u64 __percentile(const u64 (&buckets)[BucketCount], f64 percentile) const;
+
+			private:
+				u64 m_requests { 0 };
+				u64 m_reads { 0 };
+				u64 m_writes { 0 };
+				u64 m_failed { 0 };
+				u64 m_bytesRead { 0 };
+				u64 m_bytesWritten { 0 };
+				u64 m_totalCycles { 0 };
+				u64 m_totalWallTimeNs { 0 };
+				u64 m_cycleBuckets[BucketCount] { 0 };
+				u64 m_wallTimeBuckets[BucketCount] { 0 };
+		};
+
+		class DiskTraceFile
+		{
+			public: struct tStructure
+			{
+				inline static constexpr u16 Magic								= 0x000;
+				inline static constexpr u16 Version								= 0x008;
+
+				inline static constexpr u16 RecordDisk							= 0x000;
+				inline static constexpr u16 RecordMode							= 0x001;
+				inline static constexpr u16 RecordSuccess						= 0x002;
+				inline static constexpr u16 RecordSource						= 0x003;
+				inline static constexpr u16 RecordAddress						= 0x004;
+				inline static constexpr u16 RecordSize							= 0x008;
+				inline static constexpr u16 RecordStartCycle					= 0x00C;
+				inline static constexpr u16 RecordEndCycle						= 0x014;
+				inline static constexpr u16 RecordWallTimeNs					= 0x01C;
+
+				inline static constexpr u16 HeaderSizeBytes						= 0x010;
+				inline static constexpr u16 RecordSizeBytes						= 0x024;
+				inline static constexpr u16 CurrentVersion						= 0x0001;
+				inline static constexpr u32 FlushThresholdRecords				= 4096;
+				inline static constexpr const char* MagicString				= "DVMTRACE";
+			};
+			public: struct tSourceValues
+			{
+				inline static constexpr u8 Registers = 0x00;
+				inline static constexpr u8 Queue = 0x01;
+			};
+			public: struct tRecord
+			{
+				u8 disk { 0 };
+				bool write { false };
+				bool success { false };
+				u8 source { tSourceValues::Registers };
+				u32 address { 0 };
+				u16 size { 0 };
+				u64 startCycle { 0 };
+				u64 endCycle { 0 };
+				u64 wallTimeNs { 0 };
+			};
+
+			public:
+				inline DiskTraceFile(void) {  }
+				inline ~DiskTraceFile(void) { close(); }
+				DiskTraceFile(const DiskTraceFile&) = delete;
+				DiskTraceFile& operator=(const DiskTraceFile&) = delete;
+
+				bool open(const String& filePath);
+				void close(void);
+				void record(const tRecord& record);
+				inline bool isOpen(void) const { return m_file.is_open(); }
+
+				static bool load(const String& filePath, std::vector<tRecord>& outRecords);
+
+			private:
+				void __flush(void);
+
+			private:
+				std::ofstream m_file;
+				ostd::ByteStream m_buffer;
+				u32 m_bufferedRecords { 0 };
+		};
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "VirtualIODevices.hpp"
+#include <atomic>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Immutable copy of everything the renderer needs to draw one frame
+		struct tDisplaySnapshot
+		{
+			u8 videoMode { 0 };
+			bool invertColors { false };
+			bool forceRepaint { false };
+			std::vector<interface::Graphics::tText16_Cell> text16Cells;
+			std::vector<char> singleTextRows;
+			u64 singleTextTop { 0 };
+			std::vector<u8> pixel16Frame;
+		};
+
+		//Lock-free triple buffer: the emulation thread fills one slot while the render thread reads another,
+		// the third one holds the latest published frame until it gets picked up (or replaced by a newer one)
+		class DisplaySnapshotExchange
+		{
+			public:
+				inline tDisplaySnapshot& getWriteSlot(void) { return m_slots[m_writeIndex]; }
+				inline const tDisplaySnapshot& getReadSlot(void) const { return m_slots[m_readIndex]; }
+
+				inline void publish(void)
+				{
+					m_writeIndex = m_latest.exchange(m_writeIndex | FreshBit, std::memory_order_acq_rel) & IndexMask;
+				}
+
+				inline bool acquire(void)
+				{
+					if ((m_latest.load(std::memory_order_acquire) & FreshBit) == 0)
+						return false;
+					m_readIndex = m_latest.exchange(m_readIndex, std::memory_order_acq_rel) & IndexMask;
+					return true;
+				}
+
+			private:
+				inline static constexpr u8 IndexMask = 0x03;
+				inline static constexpr u8 FreshBit = 0x04;
+
+				tDisplaySnapshot m_slots[3];
+				u8 m_writeIndex { 0 };
+				u8 m_readIndex { 1 };
+				std::atomic<u8> m_latest { 2 };
+		};
+	}
+}
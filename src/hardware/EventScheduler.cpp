@@ -0,0 +1,62 @@
+#include "EventScheduler.hpp"
+
+namespace dragon
+{
+	namespace hw
+	{
+		u64 EventScheduler::schedule(u64 cycle, EventCallback callback)
+		{
+			//Cycle 0 is used as "no deadline" by getNextDeadline()
+			tEvent event;
+			event.cycle = (cycle == 0 ? 1 : cycle);
+			event.id = m_nextID++;
+			event.callback = std::move(callback);
+			m_events.push(std::move(event));
+			return m_nextID - 1;
+		}
+
+		void EventScheduler::cancel(u64 eventID)
+		{
+			//Cancelled events are only discarded once they reach the top of the queue
+			if (eventID != InvalidEvent)
+				m_cancelled.insert(eventID);
+		}
+
+		void EventScheduler::runDue(u64 now)
+		{
+			__drop_cancelled();
+			while (!m_events.empty() && m_events.top().cycle <= now)
+			{
+				//Popped before running: the callback is free to schedule (or cancel) other events
+				EventCallback callback = std::move(const_cast<tEvent&>(m_events.top()).callback);
+				m_events.pop();
+				m_runEvents++;
+				callback();
+				__drop_cancelled();
+			}
+		}
+
+		u64 EventScheduler::getNextDeadline(void)
+		{
+			__drop_cancelled();
+			return (m_events.empty() ? 0 : m_events.top().cycle);
+		}
+
+		void EventScheduler::clear(void)
+		{
+			m_events = {};
+			m_cancelled.clear();
+		}
+
+		void EventScheduler::__drop_cancelled(void)
+		{
+			while (!m_events.empty() && m_cancelled.size() > 0)
+			{
+				auto it = m_cancelled.find(m_events.top().id);
+				if (it == m_cancelled.end()) break;
+				m_cancelled.erase(it);
+				m_events.pop();
+			}
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Device work keyed on virtual time (VirtualCPU cycles): instead of checking the cycle counter every cycle,
+		// a device schedules a callback for the cycle it needs and the runtime runs it once that cycle is reached
+		class EventScheduler
+		{
+			public: using EventCallback = std::function<void(void)>;
+
+			public:
+				inline static constexpr u64 InvalidEvent = 0;
+
+			public:
+				inline EventScheduler(void) {  }
+				EventScheduler(const EventScheduler&) = delete;
+				EventScheduler& operator=(const EventScheduler&) = delete;
+
+				u64 schedule(u64 cycle, EventCallback callback);
+				void cancel(u64 eventID);
+				void runDue(u64 now);
+				u64 getNextDeadline(void);
+				void clear(void);
+
+				inline bool isEmpty(void) { return getNextDeadline() == 0; }
+				inline u64 getRunEventCount(void) const { return m_runEvents; }
+
+			private: struct tEvent
+			{
+				u64 cycle { 0 };
+				u64 id { InvalidEvent };
+				EventCallback callback;
+			};
+
+			//Earliest cycle first; events due on the same cycle run in the order they were scheduled
+			private: struct tLaterFirst
+			{
+				inline bool operator()(const tEvent& a, const tEvent& b) const { return a.cycle > b.cycle || (a.cycle == b.cycle && a.id > b.id); }
+			};
+
+			private:
+				void __drop_cancelled(void);
+
+			private:
+				std::priority_queue<tEvent, std::vector<tEvent>, tLaterFirst> m_events;
+				std::unordered_set<u64> m_cancelled;
+				u64 m_nextID { 1 };
+				u64 m_runEvents { 0 };
+		};
+	}
+}
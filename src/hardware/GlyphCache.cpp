@@ -0,0 +1,103 @@
+#include "GlyphCache.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define DRAGON_GLYPH_CACHE_AVX2
+	#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+	#define DRAGON_GLYPH_CACHE_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		bool GlyphCache::init(u8 glyphWidth, u8 glyphHeight)
+		{
+			m_glyphRows.clear();
+			if (glyphWidth == 0 || glyphWidth > MaxGlyphWidth || glyphHeight == 0)
+				return false;
+			m_glyphWidth = glyphWidth;
+			m_glyphHeight = glyphHeight;
+			m_glyphRows.resize(256 * glyphHeight, 0);
+			m_blit = __blit_rows_scalar;
+#if defined(DRAGON_GLYPH_CACHE_SSE2)
+			m_blit = __blit_rows_sse2;
+#endif
+#if defined(DRAGON_GLYPH_CACHE_AVX2)
+			if (__builtin_cpu_supports("avx2"))
+				m_blit = __blit_rows_avx2;
+#endif
+			return true;
+		}
+
+		void GlyphCache::drawCellPixels(u32* screen, u32 screenWidth, u32 cellX, u32 cellY, u8 character, u32 foreground, u32 background) const
+		{
+			u32* dest = screen + (cellY * m_glyphHeight * screenWidth) + (cellX * m_glyphWidth);
+			m_blit(dest, screenWidth, &m_glyphRows[character * m_glyphHeight], m_glyphWidth, m_glyphHeight, foreground, background);
+		}
+
+		void GlyphCache::__blit_rows_scalar(u32* dest, u32 stride, const u32* rows, u8 width, u8 height, u32 foreground, u32 background)
+		{
+			for (u8 y = 0; y < height; y++, dest += stride)
+			{
+				u32 bits = rows[y];
+				for (u8 x = 0; x < width; x++)
+					dest[x] = ((bits >> x) & 1) ? foreground : background;
+			}
+		}
+
+		void GlyphCache::__blit_rows_sse2(u32* dest, u32 stride, const u32* rows, u8 width, u8 height, u32 foreground, u32 background)
+		{
+#if defined(DRAGON_GLYPH_CACHE_SSE2)
+			const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+			const __m128i fg = _mm_set1_epi32((i32)foreground);
+			const __m128i bg = _mm_set1_epi32((i32)background);
+			for (u8 y = 0; y < height; y++, dest += stride)
+			{
+				u32 bits = rows[y];
+				u8 x = 0;
+				for (; x + 4 <= width; x += 4)
+				{
+					__m128i mask = _mm_and_si128(_mm_set1_epi32((i32)(bits >> x)), lanes);
+					mask = _mm_cmpeq_epi32(mask, lanes);
+					__m128i pixels = _mm_or_si128(_mm_and_si128(mask, fg), _mm_andnot_si128(mask, bg));
+					_mm_storeu_si128((__m128i*)(dest + x), pixels);
+				}
+				for (; x < width; x++)
+					dest[x] = ((bits >> x) & 1) ? foreground : background;
+			}
+#else
+			__blit_rows_scalar(dest, stride, rows, width, height, foreground, background);
+#endif
+		}
+
+#if defined(DRAGON_GLYPH_CACHE_AVX2)
+		__attribute__((target("avx2")))
+#endif
+		void GlyphCache::__blit_rows_avx2(u32* dest, u32 stride, const u32* rows, u8 width, u8 height, u32 foreground, u32 background)
+		{
+#if defined(DRAGON_GLYPH_CACHE_AVX2)
+			const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+			const __m256i fg = _mm256_set1_epi32((i32)foreground);
+			const __m256i bg = _mm256_set1_epi32((i32)background);
+			for (u8 y = 0; y < height; y++, dest += stride)
+			{
+				u32 bits = rows[y];
+				u8 x = 0;
+				for (; x + 8 <= width; x += 8)
+				{
+					__m256i mask = _mm256_and_si256(_mm256_set1_epi32((i32)(bits >> x)), lanes);
+					mask = _mm256_cmpeq_epi32(mask, lanes);
+					_mm256_storeu_si256((__m256i*)(dest + x), _mm256_blendv_epi8(bg, fg, mask));
+				}
+				for (; x < width; x++)
+					dest[x] = ((bits >> x) & 1) ? foreground : background;
+			}
+#else
+			__blit_rows_scalar(dest, stride, rows, width, height, foreground, background);
+#endif
+		}
+	}
+}
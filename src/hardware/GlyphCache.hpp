@@ -0,0 +1,48 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Pre-rasterized font: one bit per pixel per glyph row, plus the screen pixel value of each palette color
+		class GlyphCache
+		{
+			public:
+				inline GlyphCache(void) {  }
+				bool init(u8 glyphWidth, u8 glyphHeight);
+
+				inline void setGlyphRow(u8 character, u8 row, u32 bits) { m_glyphRows[(character * m_glyphHeight) + row] = bits; }
+				inline void setPaletteColor(u8 index, u32 pixel) { if (index < PaletteSize) m_palette[index] = pixel; }
+				inline void setFallbackColor(u32 pixel) { m_palette[PaletteSize] = pixel; }
+
+				inline bool isValid(void) const { return m_glyphRows.size() > 0; }
+				inline u8 getGlyphWidth(void) const { return m_glyphWidth; }
+				inline u8 getGlyphHeight(void) const { return m_glyphHeight; }
+
+				inline void drawCell(u32* screen, u32 screenWidth, u32 cellX, u32 cellY, u8 character, u8 foreground, u8 background) const { drawCellPixels(screen, screenWidth, cellX, cellY, character, __color(foreground), __color(background)); }
+				void drawCellPixels(u32* screen, u32 screenWidth, u32 cellX, u32 cellY, u8 character, u32 foreground, u32 background) const;
+
+			private:
+				inline u32 __color(u8 index) const { return m_palette[index < PaletteSize ? index : PaletteSize]; }
+				static void __blit_rows_scalar(u32* dest, u32 stride, const u32* rows, u8 width, u8 height, u32 foreground, u32 background);
+				static void __blit_rows_sse2(u32* dest, u32 stride, const u32* rows, u8 width, u8 height, u32 foreground, u32 background);
+				static void __blit_rows_avx2(u32* dest, u32 stride, const u32* rows, u8 width, u8 height, u32 foreground, u32 background);
+
+			public:
+				inline static constexpr u8 PaletteSize = 16;
+				inline static constexpr u8 MaxGlyphWidth = 32;
+
+			private:
+				using BlitFunction = void (*)(u32*, u32, const u32*, u8, u8, u32, u32);
+
+				std::vector<u32> m_glyphRows;
+				u32 m_palette[PaletteSize + 1] { 0 };
+				u8 m_glyphWidth { 0 };
+				u8 m_glyphHeight { 0 };
+				BlitFunction m_blit { __blit_rows_scalar };
+		};
+	}
+}
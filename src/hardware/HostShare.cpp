@@ -0,0 +1,205 @@
+#include "HostShare.hpp"
+#include <algorithm>
+#include <limits>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		bool HostShare::mount(const String& rootDirectory, bool writable)
+		{
+			unmount();
+			std::error_code error;
+			std::filesystem::path root = std::filesystem::canonical(rootDirectory.cpp_str(), error);
+			if (error || !std::filesystem::is_directory(root, error))
+				return false;
+			m_root = root;
+			m_writable = writable;
+			m_mounted = true;
+			return true;
+		}
+
+		void HostShare::unmount(void)
+		{
+			for (auto& file : m_files)
+			{
+				if (file.stream.is_open())
+					file.stream.close();
+				file.writable = false;
+			}
+			m_mounted = false;
+			m_writable = false;
+		}
+
+		u8 HostShare::openFile(const String& path, u8 flags, u16& outHandle)
+		{
+			outHandle = 0;
+			if (!m_mounted) return tStatusValues::Disabled;
+			bool writing = (flags & tOpenFlags::Write) != 0;
+			if ((flags & (tOpenFlags::Read | tOpenFlags::Write)) == 0 || (!writing && (flags & (tOpenFlags::Create | tOpenFlags::Truncate)) != 0))
+				return tStatusValues::InvalidOperation;
+			if (writing && !m_writable)
+				return tStatusValues::ReadOnly;
+			std::filesystem::path fullPath;
+			if (!__resolve(path, fullPath))
+				return tStatusValues::InvalidPath;
+			u16 index = 0;
+			while (index < MaxOpenFiles && m_files[index].stream.is_open())
+				index++;
+			if (index >= MaxOpenFiles)
+				return tStatusValues::TooManyOpenFiles;
+
+			std::error_code error;
+			if (!std::filesystem::is_regular_file(fullPath, error))
+			{
+				if (std::filesystem::exists(fullPath, error))
+					return tStatusValues::InvalidOperation;
+				if ((flags & tOpenFlags::Create) == 0)
+					return tStatusValues::NotFound;
+#ifndef _WIN32
+				//weakly_canonical() cannot resolve a dangling symlink, so the file is created with O_EXCL | O_NOFOLLOW:
+				// a link at fullPath makes the call fail instead of creating its target outside the share
+				i32 fd = ::open(fullPath.c_str(), O_CREAT | O_EXCL | O_NOFOLLOW | O_WRONLY | O_CLOEXEC, 0644);
+				if (fd < 0)
+					return tStatusValues::IOError;
+				::close(fd);
+#else
+				std::ofstream create(fullPath, std::ios::binary);
+				if (!create.is_open())
+					return tStatusValues::IOError;
+				create.close();
+#endif
+				//Checked again now that the file exists, in case the path changed under us
+				std::filesystem::path createdPath;
+				if (!__resolve(path, createdPath) || createdPath != fullPath)
+				{
+					std::filesystem::remove(fullPath, error);
+					return tStatusValues::InvalidPath;
+				}
+			}
+			std::ios::openmode mode = std::ios::binary;
+			if ((flags & tOpenFlags::Read) != 0) mode |= std::ios::in;
+			if (writing) mode |= std::ios::in | std::ios::out;
+			if ((flags & tOpenFlags::Truncate) != 0) mode |= std::ios::trunc;
+			tOpenFile& file = m_files[index];
+			file.stream.open(fullPath, mode);
+			if (!file.stream.is_open())
+				return tStatusValues::IOError;
+			file.writable = writing;
+			outHandle = index + 1;
+			return tStatusValues::Success;
+		}
+
+		u8 HostShare::closeFile(u16 handle)
+		{
+			if (!m_mounted) return tStatusValues::Disabled;
+			tOpenFile* file = __get_file(handle);
+			if (file == nullptr) return tStatusValues::InvalidHandle;
+			file->stream.close();
+			file->writable = false;
+			return (file->stream.fail() ? tStatusValues::IOError : tStatusValues::Success);
+		}
+
+		u8 HostShare::read(u16 handle, u32 offset, u8* data, u16 size, u16& outRead)
+		{
+			outRead = 0;
+			if (!m_mounted) return tStatusValues::Disabled;
+			tOpenFile* file = __get_file(handle);
+			if (file == nullptr) return tStatusValues::InvalidHandle;
+			file->stream.clear();
+			if (!file->stream.seekg(offset))
+				return tStatusValues::IOError;
+			file->stream.read((char*)data, size);
+			outRead = (u16)file->stream.gcount();
+			//Hitting the end of the file is a short read, not an error
+			file->stream.clear();
+			return tStatusValues::Success;
+		}
+
+		u8 HostShare::write(u16 handle, u32 offset, const u8* data, u16 size, u16& outWritten)
+		{
+			outWritten = 0;
+			if (!m_mounted) return tStatusValues::Disabled;
+			tOpenFile* file = __get_file(handle);
+			if (file == nullptr) return tStatusValues::InvalidHandle;
+			if (!file->writable) return tStatusValues::ReadOnly;
+			file->stream.clear();
+			if (!file->stream.seekp(offset) || !file->stream.write((const char*)data, size))
+			{
+				file->stream.clear();
+				return tStatusValues::IOError;
+			}
+			outWritten = size;
+			return tStatusValues::Success;
+		}
+
+		u8 HostShare::stat(const String& path, u32& outSize, u8& outType)
+		{
+			outSize = 0;
+			outType = 0;
+			if (!m_mounted) return tStatusValues::Disabled;
+			std::filesystem::path fullPath;
+			if (!__resolve(path, fullPath))
+				return tStatusValues::InvalidPath;
+			std::error_code error;
+			auto status = std::filesystem::status(fullPath, error);
+			if (error || !std::filesystem::exists(status))
+				return tStatusValues::NotFound;
+			if (std::filesystem::is_directory(status))
+			{
+				outType = tEntryTypes::Directory;
+				return tStatusValues::Success;
+			}
+			u64 size = std::filesystem::file_size(fullPath, error);
+			if (error) return tStatusValues::IOError;
+			outType = tEntryTypes::File;
+			outSize = (u32)std::min(size, (u64)std::numeric_limits<u32>::max());
+			return tStatusValues::Success;
+		}
+
+		u8 HostShare::getOpenFileCount(void) const
+		{
+			u8 count = 0;
+			for (auto& file : m_files)
+				count += (file.stream.is_open() ? 1 : 0);
+			return count;
+		}
+
+		bool HostShare::__resolve(const String& path, std::filesystem::path& outPath) const
+		{
+			//Guest paths are always relative to the root of the share, a leading '/' is allowed
+			std::string relative = path.cpp_str();
+			while (relative.size() > 0 && (relative[0] == '/' || relative[0] == '\\'))
+				relative.erase(0, 1);
+			if (relative == "") return false;
+			std::filesystem::path guestPath(relative);
+			if (guestPath.has_root_name() || guestPath.is_absolute())
+				return false;
+			for (auto& part : guestPath)
+			{
+				if (part == "..")
+					return false;
+			}
+			std::error_code error;
+			std::filesystem::path fullPath = std::filesystem::weakly_canonical(m_root / guestPath, error);
+			if (error) return false;
+			//Symlinks are followed by weakly_canonical(), so this also catches links leading out of the share
+			auto mismatch = std::mismatch(m_root.begin(), m_root.end(), fullPath.begin(), fullPath.end());
+			if (mismatch.first != m_root.end())
+				return false;
+			outPath = fullPath;
+			return true;
+		}
+
+		HostShare::tOpenFile* HostShare::__get_file(u16 handle)
+		{
+			if (handle == 0 || handle > MaxOpenFiles) return nullptr;
+			tOpenFile* file = &m_files[handle - 1];
+			return (file->stream.is_open() ? file : nullptr);
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <filesystem>
+#include <fstream>
+#include <array>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Host directory exposed to the guest through the HostCall device. Every guest path is resolved
+		// inside the root (no absolute paths, no "..", no symlinks pointing outside of it)
+		class HostShare
+		{
+			public: struct tStatusValues
+			{
+				inline static constexpr u8 Success = 0x00;
+				inline static constexpr u8 Disabled = 0x01;
+				inline static constexpr u8 InvalidOperation = 0x02;
+				inline static constexpr u8 InvalidPath = 0x03;
+				inline static constexpr u8 NotFound = 0x04;
+				inline static constexpr u8 InvalidHandle = 0x05;
+				inline static constexpr u8 TooManyOpenFiles = 0x06;
+				inline static constexpr u8 ReadOnly = 0x07;
+				inline static constexpr u8 IOError = 0x08;
+			};
+
+			public: struct tOpenFlags
+			{
+				inline static constexpr u8 Read = 0x01;
+				inline static constexpr u8 Write = 0x02;
+				inline static constexpr u8 Create = 0x04;
+				inline static constexpr u8 Truncate = 0x08;
+			};
+
+			public: struct tEntryTypes
+			{
+				inline static constexpr u8 File = 0x01;
+				inline static constexpr u8 Directory = 0x02;
+			};
+
+			public:
+				inline static constexpr u16 MaxOpenFiles = 16;
+				inline static constexpr u16 MaxPathLength = 255;
+
+			public:
+				inline HostShare(void) {  }
+				HostShare(const HostShare&) = delete;
+				HostShare& operator=(const HostShare&) = delete;
+
+				bool mount(const String& rootDirectory, bool writable);
+				void unmount(void);
+
+				u8 openFile(const String& path, u8 flags, u16& outHandle);
+				u8 closeFile(u16 handle);
+				u8 read(u16 handle, u32 offset, u8* data, u16 size, u16& outRead);
+				u8 write(u16 handle, u32 offset, const u8* data, u16 size, u16& outWritten);
+				u8 stat(const String& path, u32& outSize, u8& outType);
+
+				inline bool isMounted(void) const { return m_mounted; }
+				inline bool isWritable(void) const { return m_writable; }
+				u8 getOpenFileCount(void) const;
+
+			private: struct tOpenFile
+			{
+				std::fstream stream;
+				bool writable { false };
+			};
+
+			private:
+				bool __resolve(const String& path, std::filesystem::path& outPath) const;
+				tOpenFile* __get_file(u16 handle);
+
+			private:
+				std::filesystem::path m_root;
+				std::array<tOpenFile, MaxOpenFiles> m_files;
+				bool m_mounted { false };
+				bool m_writable { false };
+		};
+	}
+}
@@ -0,0 +1,319 @@
+#include "InputScript.hpp"
+#include "VirtualIODevices.hpp"
+#include "../tools/GlobalData.hpp"
+#include <ostd/io/File.hpp>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <unordered_map>
+
+namespace dragon
+{
+	namespace hw
+	{
+		bool InputScript::load(const String& filePath, u32 clockRate, String& outError)
+		{
+			m_commands.clear();
+			m_markers.clear();
+			m_cycle = 0;
+			m_lastCommandCycle = 0;
+			m_lastInputCycle = 0;
+			m_next = 0;
+			m_clockRate = clockRate;
+			m_waitingForText = false;
+			m_loaded = false;
+			ostd::TextFileBuffer file(filePath.cpp_str());
+			if (!file.exists())
+			{
+				outError = String("unable to open ").add(filePath);
+				return false;
+			}
+			u64 type_interval = DefaultTypeInterval;
+			i32 line_nr = 0;
+			for (auto& line : file.getLines())
+			{
+				line_nr++;
+				String lineEdit = line;
+				lineEdit.trim();
+				if (lineEdit == "" || lineEdit.startsWith("#")) continue;
+				if (lineEdit.startsWith("interval "))
+				{
+					//interval N: cycles between the characters of the following <type> commands
+					String value = lineEdit.new_substr(9);
+					value.trim();
+					if (!value.isInt() || value.startsWith("-"))
+					{
+						outError = String("line ").add(line_nr).add(": <interval> must be a positive integer.");
+						return false;
+					}
+					type_interval = (u64)value.toInt();
+					continue;
+				}
+				tCommand command;
+				String error = "";
+				if (!__parse_line(lineEdit, command, error))
+				{
+					outError = String("line ").add(line_nr).add(": ").add(error);
+					return false;
+				}
+				if (command.command != eCommand::Type)
+				{
+					m_commands.push_back(command);
+					continue;
+				}
+				//<type> is expanded here: press, text and release for each character (<TypeEventSpacing> cycles apart),
+				// the characters themselves are <type_interval> cycles apart
+				bool first = true;
+				for (char c : command.text)
+				{
+					tCommand key;
+					key.relative = (first ? command.relative : true);
+					key.time = (first ? command.time : type_interval);
+					key.modifiers = 0;
+					if (c == '\n')
+						key.keyCode = (i16)VirtualKeyboard::eKeys::Return;
+					else if (c == '\t')
+						key.keyCode = (i16)VirtualKeyboard::eKeys::Tab;
+					else if (isupper((u8)c))
+					{
+						key.keyCode = (i16)tolower((u8)c);
+						key.modifiers = (1 << VirtualKeyboard::tModifierBits::LeftShift);
+					}
+					else
+						key.keyCode = (i16)(u8)c;
+					key.command = eCommand::Press;
+					m_commands.push_back(key);
+					key.relative = true;
+					key.time = TypeEventSpacing;
+					if (isprint((u8)c))
+					{
+						key.command = eCommand::Text;
+						key.text = String("").add(c);
+						m_commands.push_back(key);
+					}
+					key.command = eCommand::Release;
+					m_commands.push_back(key);
+					first = false;
+				}
+			}
+			m_loaded = true;
+			return true;
+		}
+
+		void InputScript::step(u64 cycle, VirtualKeyboard& keyboard)
+		{
+			m_cycle = cycle;
+			while (!m_waitingForText && m_next < m_commands.size())
+			{
+				auto& command = m_commands[m_next];
+				u64 due = (command.relative ? m_lastCommandCycle + command.time : command.time);
+				if (m_cycle < due) break;
+				m_next++;
+				m_lastCommandCycle = m_cycle;
+				switch (command.command)
+				{
+					case eCommand::Press:
+						keyboard.queueKeyEvent(command.keyCode, command.modifiers, data::InterruptCodes::KeyPressed);
+						m_lastInputCycle = m_cycle;
+					break;
+					case eCommand::Release:
+						keyboard.queueKeyEvent(command.keyCode, command.modifiers, data::InterruptCodes::KeyReleased);
+						m_lastInputCycle = m_cycle;
+					break;
+					case eCommand::Text:
+						for (char c : command.text)
+							keyboard.queueKeyEvent((i16)c, command.modifiers, data::InterruptCodes::TextEntered);
+						m_lastInputCycle = m_cycle;
+					break;
+					case eCommand::Mark:
+						__add_marker(command.name);
+					break;
+					case eCommand::WaitText:
+						m_waitingForText = true;
+					break;
+					default: break;
+				}
+			}
+		}
+
+		void InputScript::checkScreen(const String& screenText)
+		{
+			if (!m_waitingForText) return;
+			auto& command = m_commands[m_next - 1];
+			if (!screenText.contains(command.text)) return;
+			__add_marker(command.name);
+			m_lastCommandCycle = m_cycle;
+			m_waitingForText = false;
+		}
+
+		bool InputScript::saveReport(const String& filePath) const
+		{
+			std::ofstream file(filePath.cpp_str());
+			if (!file) return false;
+			file << "marker,cycle,cycles_since_input,ms_since_input\n";
+			for (auto& marker : m_markers)
+			{
+				f64 ms = (m_clockRate > 0 ? (marker.cyclesSinceInput * 1000.0) / m_clockRate : 0.0);
+				file << marker.name.cpp_str() << "," << marker.cycle << "," << marker.cyclesSinceInput << "," << ms << "\n";
+			}
+			return (bool)file;
+		}
+
+		bool InputScript::__parse_line(const String& line, tCommand& outCommand, String& outError)
+		{
+			//TIME COMMAND [ARGUMENTS...]; the last argument of type/text/wait_text is the rest of the line
+			std::string str = line.cpp_str();
+			auto next_token = [&str](u64& pos) -> String {
+				while (pos < str.size() && isspace((u8)str[pos])) pos++;
+				u64 start = pos;
+				while (pos < str.size() && !isspace((u8)str[pos])) pos++;
+				return String(str.substr(start, pos - start));
+			};
+			auto rest_of_line = [&str](u64 pos) -> String {
+				String rest(str.substr(std::min<u64>(pos, str.size())));
+				rest.trim();
+				if (rest.len() >= 2 && rest.startsWith("\"") && rest.endsWith("\""))
+					rest = String(rest.cpp_str().substr(1, rest.len() - 2));
+				return __unescape(rest);
+			};
+			u64 pos = 0;
+			String time = next_token(pos);
+			if (!time.startsWith("@") && !time.startsWith("+"))
+			{
+				outError = "expected a time (@N or +N, in cycles or with an <ms> suffix).";
+				return false;
+			}
+			outCommand.relative = time.startsWith("+");
+			String value(time.cpp_str().substr(1));
+			bool millis = value.endsWith("ms");
+			if (millis)
+				value = String(value.cpp_str().substr(0, value.len() - 2));
+			if (!value.isInt() || value.startsWith("-"))
+			{
+				outError = "the time must be a positive integer.";
+				return false;
+			}
+			outCommand.time = (u64)value.toInt();
+			if (millis)
+				outCommand.time = (outCommand.time * m_clockRate) / 1000;
+
+			String command = next_token(pos);
+			command.toLower();
+			if (command == "press" || command == "release")
+			{
+				outCommand.command = (command == "press" ? eCommand::Press : eCommand::Release);
+				String key = next_token(pos);
+				if (!__parse_key(key, outCommand.keyCode))
+				{
+					outError = String("unknown key: ").add(key);
+					return false;
+				}
+				for (String modifier = next_token(pos); modifier != ""; modifier = next_token(pos))
+				{
+					if (!__parse_modifier(modifier, outCommand.modifiers))
+					{
+						outError = String("unknown modifier: ").add(modifier);
+						return false;
+					}
+				}
+			}
+			else if (command == "type" || command == "text")
+			{
+				outCommand.command = (command == "type" ? eCommand::Type : eCommand::Text);
+				outCommand.text = rest_of_line(pos);
+			}
+			else if (command == "mark" || command == "wait_text")
+			{
+				outCommand.command = (command == "mark" ? eCommand::Mark : eCommand::WaitText);
+				outCommand.name = next_token(pos);
+				if (outCommand.name == "")
+				{
+					outError = String("<").add(command).add("> needs a marker name.");
+					return false;
+				}
+				if (outCommand.command == eCommand::WaitText)
+				{
+					outCommand.text = rest_of_line(pos);
+					if (outCommand.text == "")
+					{
+						outError = "<wait_text> needs the text to wait for.";
+						return false;
+					}
+				}
+			}
+			else
+			{
+				outError = String("unknown command: ").add(command);
+				return false;
+			}
+			return true;
+		}
+
+		bool InputScript::__parse_key(const String& name, i16& outKeyCode)
+		{
+			using eKeys = VirtualKeyboard::eKeys;
+			static const std::unordered_map<String, eKeys> key_names {
+				{ "return", eKeys::Return }, { "enter", eKeys::Return }, { "escape", eKeys::Escape }, { "esc", eKeys::Escape },
+				{ "backspace", eKeys::Backspace }, { "tab", eKeys::Tab }, { "space", eKeys::Spacebar }, { "delete", eKeys::Delete },
+				{ "insert", eKeys::Insert }, { "home", eKeys::Home }, { "end", eKeys::End }, { "pageup", eKeys::PageUp },
+				{ "pagedown", eKeys::PageDown }, { "up", eKeys::UpArrow }, { "down", eKeys::DownArrow }, { "left", eKeys::LeftArrow },
+				{ "right", eKeys::RightArrow }, { "f1", eKeys::F1 }, { "f2", eKeys::F2 }, { "f3", eKeys::F3 }, { "f4", eKeys::F4 },
+				{ "f5", eKeys::F5 }, { "f6", eKeys::F6 }, { "f7", eKeys::F7 }, { "f8", eKeys::F8 }, { "f9", eKeys::F9 },
+				{ "f10", eKeys::F10 }, { "f11", eKeys::F11 }, { "f12", eKeys::F12 }
+			};
+			if (name.len() == 1)
+			{
+				outKeyCode = (i16)tolower((u8)name[0]);
+				return true;
+			}
+			auto it = key_names.find(name.new_toLower());
+			if (it == key_names.end())
+				return false;
+			outKeyCode = (i16)it->second;
+			return true;
+		}
+
+		bool InputScript::__parse_modifier(const String& name, u16& outModifiers)
+		{
+			String modifier = name.new_toLower();
+			if (modifier == "shift")
+				outModifiers |= (1 << VirtualKeyboard::tModifierBits::LeftShift);
+			else if (modifier == "ctrl")
+				outModifiers |= (1 << VirtualKeyboard::tModifierBits::LeftControl);
+			else if (modifier == "alt")
+				outModifiers |= (1 << VirtualKeyboard::tModifierBits::LeftAlt);
+			else if (modifier == "super")
+				outModifiers |= (1 << VirtualKeyboard::tModifierBits::LeftSuper);
+			else
+				return false;
+			return true;
+		}
+
+		String InputScript::__unescape(const String& text)
+		{
+			String result = "";
+			for (u64 i = 0; i < text.len(); i++)
+			{
+				char c = text[i];
+				if (c == '\\' && i + 1 < text.len())
+				{
+					char e = text[++i];
+					if (e == 'n') c = '\n';
+					else if (e == 't') c = '\t';
+					else c = e;
+				}
+				result.add(c);
+			}
+			return result;
+		}
+
+		void InputScript::__add_marker(const String& name)
+		{
+			tMarker marker;
+			marker.name = name;
+			marker.cycle = m_cycle;
+			marker.cyclesSinceInput = m_cycle - m_lastInputCycle;
+			m_markers.push_back(marker);
+		}
+	}
+}
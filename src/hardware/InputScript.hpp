@@ -0,0 +1,77 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		class VirtualKeyboard;
+
+		//Replays keyboard input at fixed emulated cycles and records when markers are reached, for reproducible benchmarks
+		// (script format: see the Input Script section of extra/info/info). <wait_text> holds the script until its text
+		// shows up in a published frame
+		class InputScript
+		{
+			public: struct tMarker
+			{
+				String name { "" };
+				u64 cycle { 0 };
+				u64 cyclesSinceInput { 0 };
+			};
+
+			public:
+				inline static constexpr u64 DefaultTypeInterval = 100;
+				//Cycles between the press, text and release of a typed character, so each one reaches the guest on its own step
+				inline static constexpr u64 TypeEventSpacing = 1;
+
+			public:
+				inline InputScript(void) {  }
+				bool load(const String& filePath, u32 clockRate, String& outError);
+
+				//Called before every instruction with the current VirtualCPU cycle count, before the keyboard applies its pending events
+				void step(u64 cycle, VirtualKeyboard& keyboard);
+				void checkScreen(const String& screenText);
+
+				inline bool isLoaded(void) const { return m_loaded; }
+				inline bool isWaitingForText(void) const { return m_waitingForText; }
+				inline bool isFinished(void) const { return m_next >= m_commands.size() && !m_waitingForText; }
+				inline u64 getCycle(void) const { return m_cycle; }
+				inline u32 getClockRate(void) const { return m_clockRate; }
+				inline const std::vector<tMarker>& getMarkers(void) const { return m_markers; }
+				bool saveReport(const String& filePath) const;
+
+			private:
+				enum class eCommand { Press = 0, Release, Type, Text, Mark, WaitText };
+				struct tCommand
+				{
+					eCommand command { eCommand::Mark };
+					bool relative { false };
+					u64 time { 0 };
+					i16 keyCode { 0 };
+					u16 modifiers { 0 };
+					String text { "" };
+					String name { "" };
+				};
+
+				bool __parse_line(const String& line, tCommand& outCommand, String& outError);
+				static bool __parse_key(const String& name, i16& outKeyCode);
+				static bool __parse_modifier(const String& name, u16& outModifiers);
+				static String __unescape(const String& text);
+				void __add_marker(const String& name);
+
+			private:
+				std::vector<tCommand> m_commands;
+				std::vector<tMarker> m_markers;
+				u64 m_cycle { 0 };
+				u64 m_lastCommandCycle { 0 };
+				u64 m_lastInputCycle { 0 };
+				u32 m_next { 0 };
+				u32 m_clockRate { 0 };
+				bool m_waitingForText { false };
+				bool m_loaded { false };
+		};
+	}
+}
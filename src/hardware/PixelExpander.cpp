@@ -0,0 +1,87 @@
+#include "PixelExpander.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define DRAGON_PIXEL_EXPANDER_SSSE3
+	#include <immintrin.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		PixelExpander::PixelExpander(void)
+		{
+#if defined(DRAGON_PIXEL_EXPANDER_SSSE3)
+			if (__builtin_cpu_supports("ssse3"))
+				m_expand = __expand_ssse3;
+#endif
+		}
+
+		void PixelExpander::setPaletteColor(u8 index, u32 pixel)
+		{
+			if (index >= PaletteSize) return;
+			m_palette[index] = pixel;
+			for (u8 k = 0; k < 4; k++)
+				m_planes[k][index] = (u8)((pixel >> (k * 8)) & 0xFF);
+		}
+
+		void PixelExpander::__expand_scalar(u32* dest, const u8* packed, u16 pixelCount, const u32* palette, const u8 (*planes)[PaletteSize])
+		{
+			for (u16 x = 0; x < pixelCount; x++, dest += HorizontalScale)
+			{
+				u8 byte = packed[x / 2];
+				u32 color = palette[(x % 2 == 0) ? (byte >> 4) : (byte & 0x0F)];
+				dest[0] = color;
+				dest[1] = color;
+			}
+		}
+
+#if defined(DRAGON_PIXEL_EXPANDER_SSSE3)
+		__attribute__((target("ssse3")))
+#endif
+		void PixelExpander::__expand_ssse3(u32* dest, const u8* packed, u16 pixelCount, const u32* palette, const u8 (*planes)[PaletteSize])
+		{
+#if defined(DRAGON_PIXEL_EXPANDER_SSSE3)
+			//16 pixels (8 packed bytes) per iteration: pshufb looks up each byte plane of the palette,
+			// the planes are then interleaved back into 32-bit pixels and every pixel is written twice
+			const __m128i low_nibble = _mm_set1_epi8(0x0F);
+			const __m128i plane0 = _mm_load_si128((const __m128i*)planes[0]);
+			const __m128i plane1 = _mm_load_si128((const __m128i*)planes[1]);
+			const __m128i plane2 = _mm_load_si128((const __m128i*)planes[2]);
+			const __m128i plane3 = _mm_load_si128((const __m128i*)planes[3]);
+			u16 x = 0;
+			for (; x + 16 <= pixelCount; x += 16, packed += 8, dest += 16 * HorizontalScale)
+			{
+				__m128i bytes = _mm_loadl_epi64((const __m128i*)packed);
+				__m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble);
+				__m128i low = _mm_and_si128(bytes, low_nibble);
+				__m128i indices = _mm_unpacklo_epi8(high, low);
+
+				__m128i b0 = _mm_shuffle_epi8(plane0, indices);
+				__m128i b1 = _mm_shuffle_epi8(plane1, indices);
+				__m128i b2 = _mm_shuffle_epi8(plane2, indices);
+				__m128i b3 = _mm_shuffle_epi8(plane3, indices);
+				__m128i b01_low = _mm_unpacklo_epi8(b0, b1);
+				__m128i b01_high = _mm_unpackhi_epi8(b0, b1);
+				__m128i b23_low = _mm_unpacklo_epi8(b2, b3);
+				__m128i b23_high = _mm_unpackhi_epi8(b2, b3);
+				__m128i colors[4] = {
+					_mm_unpacklo_epi16(b01_low, b23_low),
+					_mm_unpackhi_epi16(b01_low, b23_low),
+					_mm_unpacklo_epi16(b01_high, b23_high),
+					_mm_unpackhi_epi16(b01_high, b23_high)
+				};
+				for (u8 i = 0; i < 4; i++)
+				{
+					_mm_storeu_si128((__m128i*)(dest + (i * 8)), _mm_unpacklo_epi32(colors[i], colors[i]));
+					_mm_storeu_si128((__m128i*)(dest + (i * 8) + 4), _mm_unpackhi_epi32(colors[i], colors[i]));
+				}
+			}
+			if (x < pixelCount)
+				__expand_scalar(dest, packed, pixelCount - x, palette, planes);
+#else
+			__expand_scalar(dest, packed, pixelCount, palette, planes);
+#endif
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Converts packed 4bpp scanlines (left pixel in the high nibble) to screen pixels through a 16 color palette,
+		// doubling every pixel horizontally
+		class PixelExpander
+		{
+			public:
+				inline static constexpr u8 PaletteSize = 16;
+				inline static constexpr u8 HorizontalScale = 2;
+
+			public:
+				PixelExpander(void);
+
+				void setPaletteColor(u8 index, u32 pixel);
+				inline void expandLine(u32* dest, const u8* packed, u16 pixelCount) const { m_expand(dest, packed, pixelCount, m_palette, m_planes); }
+
+			private:
+				static void __expand_scalar(u32* dest, const u8* packed, u16 pixelCount, const u32* palette, const u8 (*planes)[PaletteSize]);
+				static void __expand_ssse3(u32* dest, const u8* packed, u16 pixelCount, const u32* palette, const u8 (*planes)[PaletteSize]);
+
+			private:
+				using ExpandFunction = void (*)(u32*, const u8*, u16, const u32*, const u8 (*)[PaletteSize]);
+
+				u32 m_palette[PaletteSize] { 0 };
+				//Byte k of every palette color, so the SIMD path can look colors up one byte plane at a time
+				alignas(16) u8 m_planes[4][PaletteSize] { { 0 } };
+				ExpandFunction m_expand { __expand_scalar };
+		};
+	}
+}
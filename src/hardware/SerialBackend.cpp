@@ -0,0 +1,529 @@
+#include "SerialBackend.hpp"
+#include "WakeupSignal.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#ifndef _WIN32
+	#include <cerrno>
+	#include <csignal>
+	#include <cstdlib>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/stat.h>
+	#include <sys/un.h>
+	#include <termios.h>
+	#include <unistd.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		void SerialRing::resize(u32 capacity)
+		{
+			u32 size = 1;
+			while (size < capacity)
+				size <<= 1;
+			m_buffer.assign(size, 0);
+			m_capacity = size;
+			m_mask = size - 1;
+			clear();
+		}
+
+		void SerialRing::clear(void)
+		{
+			m_head.store(0, std::memory_order_relaxed);
+			m_tail.store(0, std::memory_order_release);
+		}
+
+		u32 SerialRing::push(const u8* data, u32 count)
+		{
+			u32 written = 0;
+			while (written < count)
+			{
+				u8* span = nullptr;
+				u32 length = std::min(writeSpan(span), count - written);
+				if (length == 0) break;
+				std::memcpy(span, data + written, length);
+				commit(length);
+				written += length;
+			}
+			return written;
+		}
+
+		u32 SerialRing::pop(u8* data, u32 count)
+		{
+			u32 read = 0;
+			while (read < count)
+			{
+				const u8* span = nullptr;
+				u32 length = std::min(readSpan(span), count - read);
+				if (length == 0) break;
+				std::memcpy(data + read, span, length);
+				consume(length);
+				read += length;
+			}
+			return read;
+		}
+
+		bool SerialRing::peek(u8& outByte) const
+		{
+			u32 head = m_head.load(std::memory_order_relaxed);
+			if (m_tail.load(std::memory_order_acquire) == head)
+				return false;
+			outByte = m_buffer[head & m_mask];
+			return true;
+		}
+
+		u32 SerialRing::readSpan(const u8*& outData) const
+		{
+			u32 head = m_head.load(std::memory_order_relaxed);
+			u32 size = m_tail.load(std::memory_order_acquire) - head;
+			u32 offset = head & m_mask;
+			outData = m_buffer.data() + offset;
+			return std::min(size, m_capacity - offset);
+		}
+
+		void SerialRing::consume(u32 count)
+		{
+			m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		}
+
+		u32 SerialRing::writeSpan(u8*& outData)
+		{
+			u32 tail = m_tail.load(std::memory_order_relaxed);
+			u32 free = m_capacity - (tail - m_head.load(std::memory_order_acquire));
+			u32 offset = tail & m_mask;
+			outData = m_buffer.data() + offset;
+			return std::min(free, m_capacity - offset);
+		}
+
+		void SerialRing::commit(u32 count)
+		{
+			m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		}
+
+
+
+		bool SerialBackend::start(const String& spec, String& outError)
+		{
+#ifdef _WIN32
+			outError = "host serial backends are not supported on this platform"; //TODO: Windows named pipes
+			return false;
+#else
+			if (m_running) stop();
+			String type = spec;
+			String args = "";
+			i64 separator = spec.indexOf(":");
+			if (separator >= 0)
+			{
+				type = spec.new_substr(0, separator);
+				args = spec.new_substr(separator + 1);
+			}
+			type.trim().toLower();
+			args.trim();
+			bool result = false;
+			if (type == "file")
+				result = __open_file(args, outError);
+			else if (type == "pipe")
+				result = __open_pipe(args, outError);
+			else if (type == "pty")
+				result = __open_pty(outError);
+			else if (type == "unix")
+				result = __open_unix_socket(args, outError);
+			else
+				outError = String("unknown serial backend: ").add(type);
+			if (!result || pipe(m_wakeFds) != 0)
+			{
+				if (result) outError = "unable to create the serial I/O wakeup pipe";
+				__close_all();
+				return false;
+			}
+			fcntl(m_wakeFds[0], F_SETFL, O_NONBLOCK);
+			fcntl(m_wakeFds[1], F_SETFL, O_NONBLOCK);
+			//A peer going away must show up as EPIPE on write, not kill the VM
+			std::signal(SIGPIPE, SIG_IGN);
+			m_rx.resize(RingSize);
+			m_tx.resize(RingSize);
+			m_bytesSent = 0;
+			m_bytesReceived = 0;
+			m_stopRequested = false;
+			m_running = true;
+			m_ioThread = std::thread(&SerialBackend::__io_loop, this);
+			return true;
+#endif
+		}
+
+		void SerialBackend::stop(void)
+		{
+			if (!m_running) return;
+			m_stopRequested = true;
+			__wake();
+			if (m_ioThread.joinable())
+				m_ioThread.join();
+			m_running = false;
+			__close_all();
+		}
+
+		u32 SerialBackend::write(const u8* data, u32 count)
+		{
+			//Nothing attached: behave like a line with no one listening
+			if (!m_running) return count;
+			u32 written = m_tx.push(data, count);
+			if (written > 0)
+				__wake();
+			return written;
+		}
+
+		u32 SerialBackend::read(u8* data, u32 count)
+		{
+			if (!m_running) return 0;
+			bool wasFull = m_rx.getFree() == 0;
+			u32 read = m_rx.pop(data, count);
+			//The I/O thread stops reading from the host while the ring is full
+			if (wasFull && read > 0)
+				__wake();
+			return read;
+		}
+
+		void SerialBackend::flushInput(void)
+		{
+			if (!m_running) return;
+			const u8* span = nullptr;
+			u32 length = 0;
+			while ((length = m_rx.readSpan(span)) > 0)
+				m_rx.consume(length);
+			__wake();
+		}
+
+		bool SerialBackend::__open_file(const String& args, String& outError)
+		{
+#ifndef _WIN32
+			String output = args;
+			String input = "";
+			i64 separator = args.indexOf(",");
+			if (separator >= 0)
+			{
+				output = args.new_substr(0, separator);
+				input = args.new_substr(separator + 1);
+				output.trim();
+				input.trim();
+			}
+			if (output == "")
+			{
+				outError = "missing output file for serial backend";
+				return false;
+			}
+			m_outFd = open(output.cpp_str().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK | O_CLOEXEC, 0644);
+			if (m_outFd < 0)
+			{
+				outError = String("unable to open serial output file: ").add(output);
+				return false;
+			}
+			if (input != "")
+			{
+				m_inFd = open(input.cpp_str().c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+				if (m_inFd < 0)
+				{
+					outError = String("unable to open serial input file: ").add(input);
+					return false;
+				}
+			}
+			m_type = eType::File;
+			m_path = output;
+			m_connected = true;
+#endif
+			return true;
+		}
+
+		bool SerialBackend::__open_pipe(const String& path, String& outError)
+		{
+#ifndef _WIN32
+			if (path == "")
+			{
+				outError = "missing path for serial pipe backend";
+				return false;
+			}
+			//Two FIFOs, named from the guest's point of view: <path>.in feeds the guest, <path>.out carries what it sends
+			String inPath = String(path).add(".in");
+			String outPath = String(path).add(".out");
+			if ((mkfifo(inPath.cpp_str().c_str(), 0600) != 0 && errno != EEXIST) || (mkfifo(outPath.cpp_str().c_str(), 0600) != 0 && errno != EEXIST))
+			{
+				outError = String("unable to create serial FIFOs: ").add(path).add(".{in,out}");
+				return false;
+			}
+			//Holding the write end too means the FIFO never reports EOF when a host writer comes and goes
+			m_inFd = open(inPath.cpp_str().c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+			if (m_inFd < 0)
+			{
+				outError = String("unable to open serial FIFO: ").add(inPath);
+				return false;
+			}
+			m_type = eType::Pipe;
+			m_path = outPath;
+			//The output end can only be opened once a host reader shows up, see __try_connect()
+#endif
+			return true;
+		}
+
+		bool SerialBackend::__open_pty(String& outError)
+		{
+#ifndef _WIN32
+			i32 master = posix_openpt(O_RDWR | O_NOCTTY);
+			if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+			{
+				if (master >= 0) close(master);
+				outError = "unable to allocate a pseudo-terminal";
+				return false;
+			}
+			const char* slaveName = ptsname(master);
+			m_ptySlaveFd = (slaveName != nullptr ? open(slaveName, O_RDWR | O_NOCTTY | O_CLOEXEC) : -1);
+			if (m_ptySlaveFd < 0)
+			{
+				close(master);
+				outError = "unable to open the pseudo-terminal slave";
+				return false;
+			}
+			//Raw line: the guest sees exactly the bytes the host program sends. Keeping the slave open
+			// also stops the master from reporting EIO while no program is attached
+			termios raw;
+			if (tcgetattr(m_ptySlaveFd, &raw) == 0)
+			{
+				cfmakeraw(&raw);
+				tcsetattr(m_ptySlaveFd, TCSANOW, &raw);
+			}
+			fcntl(master, F_SETFL, O_NONBLOCK);
+			fcntl(master, F_SETFD, FD_CLOEXEC);
+			m_inFd = master;
+			m_outFd = master;
+			m_type = eType::Pty;
+			m_devicePath = slaveName;
+			m_connected = true;
+#endif
+			return true;
+		}
+
+		bool SerialBackend::__open_unix_socket(const String& path, String& outError)
+		{
+#ifndef _WIN32
+			sockaddr_un address;
+			std::memset(&address, 0, sizeof(address));
+			if (path == "" || path.len() >= (i64)sizeof(address.sun_path))
+			{
+				outError = "invalid path for serial unix socket backend";
+				return false;
+			}
+			address.sun_family = AF_UNIX;
+			std::strncpy(address.sun_path, path.cpp_str().c_str(), sizeof(address.sun_path) - 1);
+			m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (m_listenFd < 0)
+			{
+				outError = "unable to create serial unix socket";
+				return false;
+			}
+			//Only a stale socket left by an earlier run is removed, never a regular file that happens to be at PATH
+			struct stat existing;
+			if (lstat(path.cpp_str().c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+				unlink(path.cpp_str().c_str());
+			if (bind(m_listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_listenFd, 1) != 0)
+			{
+				outError = String("unable to listen on serial unix socket: ").add(path);
+				return false;
+			}
+			m_type = eType::UnixSocket;
+			m_path = path;
+#endif
+			return true;
+		}
+
+		void SerialBackend::__io_loop(void)
+		{
+#ifndef _WIN32
+			//Once a stop is requested, pending output still gets a short grace period to reach the host
+			const auto drainTimeout = std::chrono::milliseconds(250);
+			std::chrono::steady_clock::time_point stopTime;
+			bool stopping = false;
+			while (true)
+			{
+				if (m_stopRequested && !stopping)
+				{
+					stopping = true;
+					stopTime = std::chrono::steady_clock::now();
+				}
+				if (stopping && (m_tx.getSize() == 0 || !m_connected || std::chrono::steady_clock::now() - stopTime > drainTimeout))
+					break;
+				__try_connect();
+
+				pollfd fds[4];
+				i32 count = 0;
+				i32 wakeIndex = -1, inIndex = -1, outIndex = -1, listenIndex = -1;
+				fds[count] = { m_wakeFds[0], POLLIN, 0 };
+				wakeIndex = count++;
+				if (m_inFd >= 0 && m_rx.getFree() > 0 && !stopping)
+				{
+					fds[count] = { m_inFd, POLLIN, 0 };
+					inIndex = count++;
+				}
+				if (m_outFd >= 0 && m_tx.getSize() > 0)
+				{
+					fds[count] = { m_outFd, POLLOUT, 0 };
+					outIndex = count++;
+				}
+				if (m_listenFd >= 0 && !m_connected)
+				{
+					fds[count] = { m_listenFd, POLLIN, 0 };
+					listenIndex = count++;
+				}
+				//A FIFO without a reader can't be polled for it, so retry the open every few milliseconds
+				bool waitingForReader = (m_type == eType::Pipe && m_outFd < 0 && m_tx.getSize() > 0);
+				if (poll(fds, count, (waitingForReader || stopping ? 10 : 100)) < 0 && errno != EINTR)
+					break;
+
+				if (fds[wakeIndex].revents & POLLIN)
+				{
+					u8 drain[64];
+					while (::read(m_wakeFds[0], drain, sizeof(drain)) > 0);
+				}
+				u64 received = m_bytesReceived;
+				bool sending = m_tx.getSize() > 0;
+				if (inIndex >= 0 && (fds[inIndex].revents & (POLLIN | POLLHUP | POLLERR)))
+				{
+					if (!__service_input())
+						__disconnect();
+				}
+				if (outIndex >= 0 && (fds[outIndex].revents & (POLLOUT | POLLHUP | POLLERR)) && m_outFd >= 0)
+				{
+					if (!__service_output())
+						__disconnect();
+				}
+				//New data or a drained transmit ring can both turn into interrupts for a vCPU sleeping in wfi
+				if (m_bytesReceived != received || (sending && m_tx.getSize() == 0))
+					WakeupSignal::notify();
+				if (listenIndex >= 0 && (fds[listenIndex].revents & POLLIN))
+					__try_connect();
+			}
+#endif
+		}
+
+		void SerialBackend::__try_connect(void)
+		{
+#ifndef _WIN32
+			if (m_type == eType::Pipe && m_outFd < 0 && m_tx.getSize() > 0)
+			{
+				//Fails with ENXIO until someone opens the FIFO for reading
+				m_outFd = open(m_path.cpp_str().c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+				m_connected = m_outFd >= 0;
+			}
+			else if (m_type == eType::UnixSocket && m_inFd < 0)
+			{
+				i32 client = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (client < 0) return;
+				m_inFd = client;
+				m_outFd = client;
+				m_connected = true;
+			}
+#endif
+		}
+
+		void SerialBackend::__disconnect(void)
+		{
+#ifndef _WIN32
+			if (m_type == eType::Pipe)
+			{
+				if (m_outFd >= 0) close(m_outFd);
+				m_outFd = -1;
+				m_connected = false;
+			}
+			else if (m_type == eType::UnixSocket)
+			{
+				if (m_inFd >= 0) close(m_inFd);
+				m_inFd = -1;
+				m_outFd = -1;
+				m_connected = false;
+			}
+			else if (m_type == eType::File && m_inFd >= 0)
+			{
+				//End of the input file: the guest just stops receiving
+				close(m_inFd);
+				m_inFd = -1;
+			}
+#endif
+		}
+
+		bool SerialBackend::__service_input(void)
+		{
+#ifndef _WIN32
+			u8* span = nullptr;
+			u32 length = 0;
+			while ((length = m_rx.writeSpan(span)) > 0)
+			{
+				ssize_t result = ::read(m_inFd, span, length);
+				if (result > 0)
+				{
+					m_rx.commit((u32)result);
+					m_bytesReceived += (u64)result;
+					continue;
+				}
+				if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+					return true;
+				return false;
+			}
+#endif
+			return true;
+		}
+
+		bool SerialBackend::__service_output(void)
+		{
+#ifndef _WIN32
+			const u8* span = nullptr;
+			u32 length = 0;
+			while ((length = m_tx.readSpan(span)) > 0)
+			{
+				ssize_t result = ::write(m_outFd, span, length);
+				if (result > 0)
+				{
+					m_tx.consume((u32)result);
+					m_bytesSent += (u64)result;
+					continue;
+				}
+				if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+					return true;
+				return false;
+			}
+#endif
+			return true;
+		}
+
+		void SerialBackend::__wake(void)
+		{
+#ifndef _WIN32
+			if (m_wakeFds[1] < 0) return;
+			u8 signal = 1;
+			[[maybe_unused]] ssize_t result = ::write(m_wakeFds[1], &signal, 1);
+#endif
+		}
+
+		void SerialBackend::__close_all(void)
+		{
+#ifndef _WIN32
+			if (m_inFd >= 0) close(m_inFd);
+			if (m_outFd >= 0 && m_outFd != m_inFd) close(m_outFd);
+			if (m_ptySlaveFd >= 0) close(m_ptySlaveFd);
+			if (m_listenFd >= 0)
+			{
+				close(m_listenFd);
+				unlink(m_path.cpp_str().c_str());
+			}
+			if (m_wakeFds[0] >= 0) close(m_wakeFds[0]);
+			if (m_wakeFds[1] >= 0) close(m_wakeFds[1]);
+#endif
+			m_inFd = m_outFd = m_listenFd = m_ptySlaveFd = -1;
+			m_wakeFds[0] = m_wakeFds[1] = -1;
+			m_type = eType::None;
+			m_path = "";
+			m_devicePath = "";
+			m_connected = false;
+		}
+	}
+}
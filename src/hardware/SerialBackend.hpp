@@ -0,0 +1,111 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Single-producer/single-consumer byte ring: one side only pushes, the other one only pops
+		class SerialRing
+		{
+			public:
+				void resize(u32 capacity);
+				void clear(void);
+
+				u32 push(const u8* data, u32 count);
+				u32 pop(u8* data, u32 count);
+				bool peek(u8& outByte) const;
+
+				//Consumer side: contiguous run of queued bytes, to be released with consume()
+				u32 readSpan(const u8*& outData) const;
+				void consume(u32 count);
+				//Producer side: contiguous run of free space, to be filled and then released with commit()
+				u32 writeSpan(u8*& outData);
+				void commit(u32 count);
+
+				inline u32 getSize(void) const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+				inline u32 getFree(void) const { return m_capacity - getSize(); }
+				inline u32 getCapacity(void) const { return m_capacity; }
+
+			private:
+				std::vector<u8> m_buffer;
+				u32 m_capacity { 0 };
+				u32 m_mask { 0 };
+				std::atomic<u32> m_head { 0 };
+				std::atomic<u32> m_tail { 0 };
+		};
+
+		//Host end of the virtual serial port. The emulation thread only touches the two rings,
+		// while a background thread moves bytes between them and the host file descriptors
+		class SerialBackend
+		{
+			public: enum class eType { None = 0, File, Pipe, Pty, UnixSocket };
+
+			public:
+				inline static constexpr u32 RingSize = 65536;
+
+			public:
+				inline SerialBackend(void) {  }
+				inline ~SerialBackend(void) { stop(); }
+				SerialBackend(const SerialBackend&) = delete;
+				SerialBackend& operator=(const SerialBackend&) = delete;
+
+				//<spec> is one of: file:OUTPUT[,INPUT]  pipe:PATH  pty  unix:PATH
+				bool start(const String& spec, String& outError);
+				void stop(void);
+
+				u32 write(const u8* data, u32 count);
+				u32 read(u8* data, u32 count);
+				inline bool peek(u8& outByte) const { return m_rx.peek(outByte); }
+				void flushInput(void);
+
+				inline bool isRunning(void) const { return m_running; }
+				inline bool isConnected(void) const { return m_connected.load(std::memory_order_relaxed); }
+				inline eType getType(void) const { return m_type; }
+				//For <pty> this is the slave device to attach to (ex. screen /dev/pts/N)
+				inline const String& getDevicePath(void) const { return m_devicePath; }
+
+				inline u32 getRxCount(void) const { return m_rx.getSize(); }
+				inline u32 getTxCount(void) const { return (m_running ? m_tx.getSize() : 0); }
+				inline u32 getTxFree(void) const { return (m_running ? m_tx.getFree() : RingSize); }
+				inline u64 getBytesSent(void) const { return m_bytesSent; }
+				inline u64 getBytesReceived(void) const { return m_bytesReceived; }
+
+			private:
+				bool __open_file(const String& args, String& outError);
+				bool __open_pipe(const String& path, String& outError);
+				bool __open_pty(String& outError);
+				bool __open_unix_socket(const String& path, String& outError);
+				void __io_loop(void);
+				void __try_connect(void);
+				void __disconnect(void);
+				bool __service_input(void);
+				bool __service_output(void);
+				void __wake(void);
+				void __close_all(void);
+
+			private:
+				SerialRing m_rx;
+				SerialRing m_tx;
+				eType m_type { eType::None };
+				String m_path { "" };
+				String m_devicePath { "" };
+				i32 m_inFd { -1 };
+				i32 m_outFd { -1 };
+				i32 m_listenFd { -1 };
+				i32 m_ptySlaveFd { -1 };
+				i32 m_wakeFds[2] { -1, -1 };
+				std::thread m_ioThread;
+				bool m_running { false };
+				std::atomic<bool> m_stopRequested { false };
+				std::atomic<bool> m_connected { false };
+				std::atomic<u64> m_bytesSent { 0 };
+				std::atomic<u64> m_bytesReceived { 0 };
+		};
+	}
+}
@@ -0,0 +1,150 @@
+#include "SharedFramebuffer.hpp"
+#include <cstring>
+#include <new>
+#include <thread>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		bool SharedFramebuffer::create(const String& name, u32 width, u32 height, u32 redMask, u32 greenMask, u32 blueMask)
+		{
+#ifdef _WIN32
+			return false; //TODO: Windows file mapping support
+#else
+			close();
+			String shm_name = normalizeName(name);
+			u32 stride = width * sizeof(u32);
+			u64 size = sizeof(tHeader) + ((u64)stride * height);
+			//O_EXCL: a segment with the same name may belong to another running VM, so it is never taken over (or unlinked on close)
+			i32 fd = shm_open(shm_name.cpp_str().c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			if (fd < 0)
+				return false;
+			if (ftruncate(fd, size) != 0)
+			{
+				::close(fd);
+				shm_unlink(shm_name.cpp_str().c_str());
+				return false;
+			}
+			void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (memory == MAP_FAILED)
+			{
+				shm_unlink(shm_name.cpp_str().c_str());
+				return false;
+			}
+			std::memset(memory, 0, size);
+			m_header = new (memory) tHeader();
+			m_header->width = width;
+			m_header->height = height;
+			m_header->stride = stride;
+			m_header->redMask = redMask;
+			m_header->greenMask = greenMask;
+			m_header->blueMask = blueMask;
+			m_header->headerSize = sizeof(tHeader);
+			m_header->version = Version;
+			m_header->sequence.store(0, std::memory_order_relaxed);
+			m_header->frameCount = 0;
+			m_pixels = (u8*)memory + sizeof(tHeader);
+			m_mappedSize = size;
+			m_name = shm_name;
+			m_owner = true;
+			//Written last, so a viewer that sees the magic also sees a complete header
+			std::atomic_thread_fence(std::memory_order_release);
+			m_header->magic = Magic;
+			return true;
+#endif
+		}
+
+		void SharedFramebuffer::publish(const u32* pixels)
+		{
+			if (!m_owner) return;
+			u32 sequence = m_header->sequence.load(std::memory_order_relaxed);
+			m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			std::memcpy(m_pixels, pixels, (u64)m_header->stride * m_header->height);
+			m_header->frameCount++;
+			m_header->sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		bool SharedFramebuffer::open(const String& name)
+		{
+#ifdef _WIN32
+			return false; //TODO: Windows file mapping support
+#else
+			close();
+			String shm_name = normalizeName(name);
+			i32 fd = shm_open(shm_name.cpp_str().c_str(), O_RDONLY, 0);
+			if (fd < 0)
+				return false;
+			off_t size = lseek(fd, 0, SEEK_END);
+			if (size < (off_t)sizeof(tHeader))
+			{
+				::close(fd);
+				return false;
+			}
+			void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (memory == MAP_FAILED)
+				return false;
+			tHeader* header = (tHeader*)memory;
+			bool valid = header->magic == Magic && header->version == Version && header->headerSize == sizeof(tHeader);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (!valid || sizeof(tHeader) + ((u64)header->stride * header->height) > (u64)size)
+			{
+				munmap(memory, size);
+				return false;
+			}
+			m_header = header;
+			m_pixels = (u8*)memory + sizeof(tHeader);
+			m_mappedSize = size;
+			m_name = shm_name;
+			m_owner = false;
+			return true;
+#endif
+		}
+
+		void SharedFramebuffer::close(void)
+		{
+#ifndef _WIN32
+			if (m_header == nullptr) return;
+			munmap((void*)m_header, m_mappedSize);
+			if (m_owner)
+				shm_unlink(m_name.cpp_str().c_str());
+			m_header = nullptr;
+			m_pixels = nullptr;
+			m_mappedSize = 0;
+			m_owner = false;
+#endif
+		}
+
+		u32 SharedFramebuffer::beginRead(void) const
+		{
+			u32 sequence = m_header->sequence.load(std::memory_order_acquire);
+			while ((sequence & 1) != 0)
+			{
+				std::this_thread::yield();
+				sequence = m_header->sequence.load(std::memory_order_acquire);
+			}
+			return sequence;
+		}
+
+		bool SharedFramebuffer::validateRead(u32 sequence) const
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return m_header->sequence.load(std::memory_order_relaxed) == sequence;
+		}
+
+		String SharedFramebuffer::normalizeName(const String& name)
+		{
+			if (name.startsWith("/"))
+				return name;
+			return String("/").add(name);
+		}
+	}
+}
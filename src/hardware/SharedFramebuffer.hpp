@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <atomic>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Screen pixels exported through a POSIX shared-memory segment, so external viewers can watch a VM without a window.
+		// The segment starts with a tHeader and is followed by height * stride bytes of 32-bit pixels.
+		// Seqlock protocol: the VM makes <sequence> odd, copies the frame, then makes it even again; a reader takes
+		// an even <sequence>, reads the pixels in place and keeps the result only if <sequence> did not change meanwhile
+		class SharedFramebuffer
+		{
+			public: struct tHeader
+			{
+				u32 magic;
+				u16 version;
+				u16 headerSize;
+				u32 width;
+				u32 height;
+				u32 stride;
+				//Bits of a pixel holding each color channel (the VM uses the renderer's own pixel format)
+				u32 redMask;
+				u32 greenMask;
+				u32 blueMask;
+				std::atomic<u32> sequence;
+				u32 reserved;
+				u64 frameCount;
+			};
+
+			public:
+				inline static constexpr u32 Magic = 0x42465644; //"DVFB"
+				inline static constexpr u16 Version = 1;
+
+			public:
+				inline SharedFramebuffer(void) {  }
+				inline ~SharedFramebuffer(void) { close(); }
+				SharedFramebuffer(const SharedFramebuffer&) = delete;
+				SharedFramebuffer& operator=(const SharedFramebuffer&) = delete;
+
+				//VM side: creates the segment, fails if one with the same name already exists
+				bool create(const String& name, u32 width, u32 height, u32 redMask, u32 greenMask, u32 blueMask);
+				void publish(const u32* pixels);
+				//Viewer side: maps an existing segment read-only
+				bool open(const String& name);
+				void close(void);
+
+				inline bool isOpen(void) const { return m_header != nullptr; }
+				inline const tHeader& getHeader(void) const { return *m_header; }
+				inline const u8* getPixels(void) const { return m_pixels; }
+
+				//Returns the (even) sequence number of a complete frame; the pixels are stable until validateRead() says otherwise
+				u32 beginRead(void) const;
+				bool validateRead(u32 sequence) const;
+
+				static String normalizeName(const String& name);
+
+			private:
+				tHeader* m_header { nullptr };
+				u8* m_pixels { nullptr };
+				u64 m_mappedSize { 0 };
+				String m_name { "" };
+				bool m_owner { false };
+		};
+	}
+}
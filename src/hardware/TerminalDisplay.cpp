@@ -0,0 +1,285 @@
+#include "TerminalDisplay.hpp"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		bool TerminalDisplay::start(u16 columns, u16 rows)
+		{
+#ifdef _WIN32
+			return false; //TODO: Windows console support
+#else
+			if (m_active) return true;
+			if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+				return false;
+			if (tcgetattr(STDIN_FILENO, &m_savedTermios) != 0)
+				return false;
+			termios raw = m_savedTermios;
+			cfmakeraw(&raw);
+			raw.c_oflag |= OPOST;
+			raw.c_cc[VMIN] = 0;
+			raw.c_cc[VTIME] = 0;
+			if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0)
+				return false;
+			m_columns = columns;
+			m_rows = rows;
+			m_frame.assign(columns * rows, tCell());
+			m_shadow.assign(columns * rows, tCell());
+			m_shadowValid = false;
+			m_active = true;
+			//Alternate screen, no cursor, no auto-wrap
+			m_output = "\x1b[?1049h\x1b[?25l\x1b[?7l\x1b[2J";
+			__flush();
+			return true;
+#endif
+		}
+
+		void TerminalDisplay::stop(void)
+		{
+#ifndef _WIN32
+			if (!m_active) return;
+			m_output = "\x1b[0m\x1b[?7h\x1b[?25h\x1b[?1049l";
+			__flush();
+			tcsetattr(STDIN_FILENO, TCSANOW, &m_savedTermios);
+			m_active = false;
+#endif
+		}
+
+		void TerminalDisplay::setPaletteColor(u8 index, const ostd::Color& color)
+		{
+			if (index > PaletteSize) return;
+			m_palette[index] = __to_xterm_256(color);
+			m_shadowValid = false;
+		}
+
+		void TerminalDisplay::setSingleTextColors(const ostd::Color& foreground, const ostd::Color& background)
+		{
+			m_singleTextForeground = __to_xterm_256(foreground);
+			m_singleTextBackground = __to_xterm_256(background);
+			m_shadowValid = false;
+		}
+
+		void TerminalDisplay::draw(const tDisplaySnapshot& snapshot)
+		{
+			if (!m_active) return;
+			__build_frame(snapshot);
+			for (u32 i = 0; i < m_frame.size(); i++)
+			{
+				if (m_shadowValid && m_frame[i] == m_shadow[i])
+					continue;
+				m_shadow[i] = m_frame[i];
+				__emit_cell(i % m_columns, i / m_columns, m_frame[i]);
+			}
+			m_shadowValid = true;
+			__flush();
+		}
+
+		bool TerminalDisplay::pollInput(VirtualKeyboard& keyboard)
+		{
+#ifdef _WIN32
+			return true;
+#else
+			if (!m_active) return true;
+			char buffer[64];
+			ssize_t count = 0;
+			while ((count = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+				m_input.append(buffer, count);
+			u32 i = 0;
+			while (i < m_input.size())
+			{
+				u8 c = (u8)m_input[i];
+				if (c == QuitKey)
+				{
+					m_input.clear();
+					return false;
+				}
+				if (c == 0x1B)
+				{
+					u32 consumed = __parse_escape(keyboard, i);
+					if (consumed == 0) break; //Incomplete sequence, wait for the rest
+					i += consumed;
+					continue;
+				}
+				if (c == '\r' || c == '\n')
+					__press_key(keyboard, (i16)VirtualKeyboard::eKeys::Return, 0, 0);
+				else if (c == 0x7F || c == '\b')
+					__press_key(keyboard, (i16)VirtualKeyboard::eKeys::Backspace, 0, 0);
+				else if (c == '\t')
+					__press_key(keyboard, (i16)VirtualKeyboard::eKeys::Tab, 0, 0);
+				else if (c >= 0x01 && c <= 0x1A)
+					__press_key(keyboard, (i16)('a' + c - 1), (1 << VirtualKeyboard::tModifierBits::LeftControl), 0);
+				else if (isupper(c))
+					__press_key(keyboard, (i16)tolower(c), (1 << VirtualKeyboard::tModifierBits::LeftShift), (char)c);
+				else if (isprint(c))
+					__press_key(keyboard, (i16)c, 0, (char)c);
+				i++;
+			}
+			m_input.erase(0, i);
+			return true;
+#endif
+		}
+
+		u8 TerminalDisplay::__to_xterm_256(const ostd::Color& color)
+		{
+			//Nearest entry of the 6x6x6 color cube or of the grayscale ramp
+			auto cube_level = [](u8 value) -> u8 { return value < 48 ? 0 : (value < 115 ? 1 : (value - 35) / 40); };
+			auto level_value = [](u8 level) -> i32 { return level == 0 ? 0 : 55 + (level * 40); };
+			u8 r = cube_level(color.r), g = cube_level(color.g), b = cube_level(color.b);
+			auto distance = [&](i32 cr, i32 cg, i32 cb) -> i32 { return ((cr - color.r) * (cr - color.r)) + ((cg - color.g) * (cg - color.g)) + ((cb - color.b) * (cb - color.b)); };
+			i32 cube_distance = distance(level_value(r), level_value(g), level_value(b));
+			i32 average = (color.r + color.g + color.b) / 3;
+			i32 gray = average > 238 ? 23 : (average < 8 ? 0 : (average - 3) / 10);
+			i32 gray_value = 8 + (gray * 10);
+			if (distance(gray_value, gray_value, gray_value) < cube_distance)
+				return (u8)(232 + gray);
+			return (u8)(16 + (36 * r) + (6 * g) + b);
+		}
+
+		void TerminalDisplay::__build_frame(const tDisplaySnapshot& snapshot)
+		{
+			for (auto& cell : m_frame)
+				cell = tCell();
+			if (snapshot.videoMode == TextSingleColorMode && snapshot.singleTextRows.size() == m_frame.size())
+			{
+				u8 foreground = (snapshot.invertColors ? m_singleTextBackground : m_singleTextForeground);
+				u8 background = (snapshot.invertColors ? m_singleTextForeground : m_singleTextBackground);
+				for (u32 i = 0; i < m_frame.size(); i++)
+					m_frame[i] = { (u8)snapshot.singleTextRows[i], foreground, background };
+			}
+			else if (snapshot.videoMode == Text16ColorsMode && snapshot.text16Cells.size() == m_frame.size())
+			{
+				for (u32 i = 0; i < m_frame.size(); i++)
+				{
+					auto& cell = snapshot.text16Cells[i];
+					m_frame[i].character = cell.character;
+					m_frame[i].foreground = m_palette[cell.foregroundColor < PaletteSize ? cell.foregroundColor : PaletteSize];
+					m_frame[i].background = m_palette[cell.backgroundColor < PaletteSize ? cell.backgroundColor : PaletteSize];
+				}
+			}
+			else
+			{
+				const char* message = "[ This video mode can only be shown in the window ]";
+				for (u32 i = 0; message[i] != 0 && i < m_columns; i++)
+					m_frame[i] = { (u8)message[i], 15, 0 };
+			}
+		}
+
+		void TerminalDisplay::__emit_cell(u16 x, u16 y, const tCell& cell)
+		{
+			char escape[32];
+			if (x != m_cursorX || y != m_cursorY)
+			{
+				std::snprintf(escape, sizeof(escape), "\x1b[%d;%dH", y + 1, x + 1);
+				m_output += escape;
+			}
+			if (cell.foreground != m_currentForeground)
+			{
+				std::snprintf(escape, sizeof(escape), "\x1b[38;5;%dm", cell.foreground);
+				m_output += escape;
+				m_currentForeground = cell.foreground;
+			}
+			if (cell.background != m_currentBackground)
+			{
+				std::snprintf(escape, sizeof(escape), "\x1b[48;5;%dm", cell.background);
+				m_output += escape;
+				m_currentBackground = cell.background;
+			}
+			m_output += (isprint(cell.character) ? (char)cell.character : ' ');
+			m_cursorX = x + 1;
+			m_cursorY = y;
+		}
+
+		void TerminalDisplay::__flush(void)
+		{
+			if (m_output.size() == 0) return;
+			std::fwrite(m_output.data(), 1, m_output.size(), stdout);
+			std::fflush(stdout);
+			m_output.clear();
+		}
+
+		u32 TerminalDisplay::__parse_escape(VirtualKeyboard& keyboard, u32 start)
+		{
+			using eKeys = VirtualKeyboard::eKeys;
+			if (start + 1 >= m_input.size())
+			{
+				//A lone ESC: terminals send whole sequences in one write, so nothing else is coming
+				__press_key(keyboard, (i16)eKeys::Escape, 0, 0);
+				return 1;
+			}
+			char introducer = m_input[start + 1];
+			if (introducer != '[' && introducer != 'O')
+			{
+				u8 c = (u8)m_input[start + 1];
+				if (isprint(c))
+					__press_key(keyboard, (i16)tolower(c), (1 << VirtualKeyboard::tModifierBits::LeftAlt), 0);
+				return 2;
+			}
+			u32 end = start + 2;
+			while (end < m_input.size() && !(m_input[end] >= 0x40 && m_input[end] <= 0x7E))
+				end++;
+			if (end >= m_input.size())
+				return 0;
+			std::string params = m_input.substr(start + 2, end - (start + 2));
+			i16 key = 0;
+			switch (m_input[end])
+			{
+				case 'A': key = (i16)eKeys::UpArrow; break;
+				case 'B': key = (i16)eKeys::DownArrow; break;
+				case 'C': key = (i16)eKeys::RightArrow; break;
+				case 'D': key = (i16)eKeys::LeftArrow; break;
+				case 'H': key = (i16)eKeys::Home; break;
+				case 'F': key = (i16)eKeys::End; break;
+				case 'P': key = (i16)eKeys::F1; break;
+				case 'Q': key = (i16)eKeys::F2; break;
+				case 'R': key = (i16)eKeys::F3; break;
+				case 'S': key = (i16)eKeys::F4; break;
+				case '~':
+				{
+					i32 code = std::atoi(params.c_str());
+					switch (code)
+					{
+						case 1: case 7: key = (i16)eKeys::Home; break;
+						case 2: key = (i16)eKeys::Insert; break;
+						case 3: key = (i16)eKeys::Delete; break;
+						case 4: case 8: key = (i16)eKeys::End; break;
+						case 5: key = (i16)eKeys::PageUp; break;
+						case 6: key = (i16)eKeys::PageDown; break;
+						case 15: key = (i16)eKeys::F5; break;
+						case 17: key = (i16)eKeys::F6; break;
+						case 18: key = (i16)eKeys::F7; break;
+						case 19: key = (i16)eKeys::F8; break;
+						case 20: key = (i16)eKeys::F9; break;
+						case 21: key = (i16)eKeys::F10; break;
+						case 23: key = (i16)eKeys::F11; break;
+						case 24: key = (i16)eKeys::F12; break;
+						default: break;
+					}
+				}
+				break;
+				default: break;
+			}
+			if (key != 0)
+				__press_key(keyboard, key, 0, 0);
+			return end - start + 1;
+		}
+
+		void TerminalDisplay::__press_key(VirtualKeyboard& keyboard, i16 keyCode, u16 modifiers, char text)
+		{
+			//Same events the window produces: a key press, the text it typed (if any) and the release.
+			// Terminals only report whole keystrokes, so every key is released right away; queueing all three together is fine,
+			// the keyboard hands them to the guest one per step (legacy mode) or through its event queue
+			keyboard.queueKeyEvent(keyCode, modifiers, data::InterruptCodes::KeyPressed);
+			if (text != 0)
+				keyboard.queueKeyEvent((i16)text, modifiers, data::InterruptCodes::TextEntered);
+			keyboard.queueKeyEvent(keyCode, modifiers, data::InterruptCodes::KeyReleased);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "DisplaySnapshot.hpp"
+#include <ostd/data/Color.hpp>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+	#include <termios.h>
+#endif
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Draws display snapshots on the host terminal with ANSI 256-color escapes, and feeds raw-mode stdin to the keyboard.
+		// A shadow copy of the last emitted frame is kept, so only cursor moves and changed runs of cells are written
+		class TerminalDisplay
+		{
+			public:
+				inline static constexpr u8 QuitKey = 0x1D;
+				inline static constexpr u8 PaletteSize = 16;
+				//Same values as VirtualDisplay::tVideoModeValues
+				inline static constexpr u8 TextSingleColorMode = 0x00;
+				inline static constexpr u8 Text16ColorsMode = 0x01;
+
+			public:
+				inline TerminalDisplay(void) {  }
+				bool start(u16 columns, u16 rows);
+				void stop(void);
+				inline bool isActive(void) const { return m_active; }
+
+				void setPaletteColor(u8 index, const ostd::Color& color);
+				void setSingleTextColors(const ostd::Color& foreground, const ostd::Color& background);
+
+				void draw(const tDisplaySnapshot& snapshot);
+				//Returns false once the quit key (Ctrl+]) has been pressed
+				bool pollInput(VirtualKeyboard& keyboard);
+
+			private:
+				struct tCell
+				{
+					u8 character { ' ' };
+					u8 foreground { 0 };
+					u8 background { 0 };
+
+					inline bool operator==(const tCell& other) const { return character == other.character && foreground == other.foreground && background == other.background; }
+				};
+
+				static u8 __to_xterm_256(const ostd::Color& color);
+				void __build_frame(const tDisplaySnapshot& snapshot);
+				void __emit_cell(u16 x, u16 y, const tCell& cell);
+				void __flush(void);
+				u32 __parse_escape(VirtualKeyboard& keyboard, u32 start);
+				void __press_key(VirtualKeyboard& keyboard, i16 keyCode, u16 modifiers, char text);
+
+			private:
+				std::vector<tCell> m_frame;
+				std::vector<tCell> m_shadow;
+				bool m_shadowValid { false };
+				std::string m_output;
+				std::string m_input;
+				u16 m_columns { 0 };
+				u16 m_rows { 0 };
+				u16 m_cursorX { 0xFFFF };
+				u16 m_cursorY { 0xFFFF };
+				i16 m_currentForeground { -1 };
+				i16 m_currentBackground { -1 };
+				u8 m_palette[PaletteSize + 1] { 0 };
+				u8 m_singleTextForeground { 15 };
+				u8 m_singleTextBackground { 0 };
+				bool m_active { false };
+#ifndef _WIN32
+				termios m_savedTermios;
+#endif
+		};
+	}
+}
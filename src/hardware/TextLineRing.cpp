@@ -0,0 +1,77 @@
+#include "TextLineRing.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace dragon
+{
+	namespace hw
+	{
+		void TextLineRing::init(u16 lineWidth, u16 visibleLines, u32 scrollbackLines)
+		{
+			m_lineWidth = lineWidth;
+			m_visibleLines = visibleLines;
+			m_capacity = (u32)visibleLines + scrollbackLines;
+			m_chars.assign(m_capacity * lineWidth, ' ');
+			m_lengths.assign(m_capacity, 0);
+			m_totalLines = 0;
+			clear();
+		}
+
+		void TextLineRing::clear(void)
+		{
+			if (m_capacity == 0) return;
+			m_first = 0;
+			m_count = 0;
+			__new_line();
+		}
+
+		void TextLineRing::addChar(char c)
+		{
+			if (m_capacity == 0) return;
+			if (c == '\n')
+			{
+				__new_line();
+				return;
+			}
+			if (!isprint(c)) return;
+			if (getLineLength(m_count - 1) == m_lineWidth)
+				__new_line();
+			u32 line = __physical(m_count - 1);
+			m_chars[(line * m_lineWidth) + m_lengths[line]] = c;
+			m_lengths[line]++;
+		}
+
+		void TextLineRing::copyVisible(std::vector<char>& outRows) const
+		{
+			outRows.assign(m_visibleLines * m_lineWidth, ' ');
+			u32 first_visible = m_count - std::min<u32>(m_count, m_visibleLines);
+			for (u32 i = first_visible, row = 0; i < m_count; i++, row++)
+				std::copy_n(getLine(i), getLineLength(i), outRows.begin() + (row * m_lineWidth));
+		}
+
+		bool TextLineRing::saveToFile(const String& filePath) const
+		{
+			std::ofstream file(filePath.cpp_str(), std::ios::out | std::ios::trunc);
+			if (!file) return false;
+			for (u32 i = 0; i < m_count; i++)
+			{
+				file.write(getLine(i), getLineLength(i));
+				file.put('\n');
+			}
+			return (bool)file;
+		}
+
+		void TextLineRing::__new_line(void)
+		{
+			if (m_count == m_capacity)
+				m_first = (m_first + 1) % m_capacity;
+			else
+				m_count++;
+			u32 line = __physical(m_count - 1);
+			m_lengths[line] = 0;
+			std::fill_n(m_chars.begin() + (line * m_lineWidth), m_lineWidth, ' ');
+			m_totalLines++;
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+#include <vector>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Fixed-capacity store of fixed-width text lines: the last <visibleLines> lines are on screen, older ones are kept
+		// as scrollback until the capacity runs out. Starting a line only moves the head index, nothing is shifted or allocated
+		class TextLineRing
+		{
+			public:
+				inline TextLineRing(void) {  }
+				void init(u16 lineWidth, u16 visibleLines, u32 scrollbackLines);
+				void clear(void);
+				void addChar(char c);
+
+				inline u32 getLineCount(void) const { return m_count; }
+				inline u16 getLineLength(u32 index) const { return m_lengths[__physical(index)]; }
+				inline const char* getLine(u32 index) const { return &m_chars[__physical(index) * m_lineWidth]; }
+				inline u16 getLineWidth(void) const { return m_lineWidth; }
+				inline u16 getVisibleLineCount(void) const { return m_visibleLines; }
+				inline u32 getScrollbackCapacity(void) const { return m_capacity - m_visibleLines; }
+				//Running number of the line shown on the first row; it grows by N when the screen scrolls by N lines
+				inline u64 getVisibleTop(void) const { return m_totalLines - std::min<u64>(m_count, m_visibleLines); }
+
+				void copyVisible(std::vector<char>& outRows) const;
+				bool saveToFile(const String& filePath) const;
+
+			private:
+				inline u32 __physical(u32 index) const { return (m_first + index) % m_capacity; }
+				void __new_line(void);
+
+			private:
+				std::vector<char> m_chars;
+				std::vector<u16> m_lengths;
+				u16 m_lineWidth { 0 };
+				u16 m_visibleLines { 0 };
+				u32 m_capacity { 0 };
+				u32 m_first { 0 };
+				u32 m_count { 0 };
+				u64 m_totalLines { 0 };
+		};
+	}
+}
@@ -2,6 +2,7 @@
 #include "../tools/GlobalData.hpp"
 
 #include <ostd/io/Memory.hpp>
+#include <algorithm>
 
 #include "../runtime/DragonRuntime.hpp"
 
@@ -157,6 +158,8 @@ namespace dragon
 			u8 interruptStatus = m_memory.read8(entryPointer);
 			if (interruptStatus != 0xFF) return;
 			u16 handlerAddress = m_memory.read16(entryPointer + 1);
+			m_waitingForInterrupt = false;
+			__reset_spin_loop();
 			pushToStack(0);
 			pushStackFrame();
 			m_subroutineCounter++;
@@ -193,7 +196,15 @@ namespace dragon
 
 		bool VirtualCPU::execute(void)
 		{
-			if (m_halt) return true;
+			//Virtual time for the devices: it keeps running while the CPU is halted
+			m_cycleCount++;
+			//Each instruction runs on its first cycle, then the CPU stays busy for the rest of its cost
+			if (m_stallCycles > 0)
+			{
+				m_stallCycles--;
+				return true;
+			}
+			if (m_halt || m_waitingForInterrupt) return true;
 			m_currentExtension = nullptr;
 			m_currentExtInst = 0x00;
 			m_isDebugBreakPoint = false;
@@ -203,9 +214,13 @@ namespace dragon
 				m_currentOffset = readRegister(data::Registers::OFFSET);
 			else
 				m_currentOffset = 0x0000;
+			u16 instAddr = readRegister(data::Registers::IP);
 			u8 inst = fetch8();
 			m_currentInst = inst;
-			if (loadExtension())
+			bool extension = loadExtension();
+			u8 cycles = data::OpCodes::getInstructionCycles(inst);
+			m_stallCycles = (cycles > 0 ? cycles - 1 : 0);
+			if (extension)
 				return m_currentExtension->execute(*this);
 			switch (inst)
 			{
@@ -817,6 +832,12 @@ namespace dragon
 					writeRegister16(regAddr, arg_data);
 				}
 				break;
+				case data::OpCodes::WaitInt:
+				{
+					//Parks the CPU until the next hardware interrupt is delivered, the handler's rti resumes after this instruction
+					m_waitingForInterrupt = true;
+				}
+				break;
 				case data::OpCodes::RetInt:
 				{
 					m_interruptHandlerCount--;
@@ -882,7 +903,107 @@ namespace dragon
 				}
 			}
 
+			__track_spin_loop(inst, instAddr);
 			return true;
 		}
+
+		bool VirtualCPU::isIdle(void)
+		{
+			if (m_waitingForInterrupt) return true;
+			if (!m_spinLoop.confirmed) return false;
+			//The loop only keeps repeating itself as long as everything it reads still holds the same value
+			for (u8 i = 0; i < m_spinLoop.readCount; i++)
+			{
+				tSpinRead& read = m_spinLoop.reads[i];
+				i16 value = (read.byte ? (m_memory.read8(read.address) & 0x00FF) : m_memory.read16(read.address));
+				if (value != read.value)
+				{
+					__reset_spin_loop();
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void VirtualCPU::skipCycles(u64 cycles)
+		{
+			//Whole iterations only (in cycles, stalls included), so the loop ends up exactly where plain execution would have left it
+			if (!m_waitingForInterrupt && m_spinLoop.confirmed)
+				cycles -= cycles % m_spinLoop.iterationCycles;
+			m_cycleCount += cycles;
+		}
+
+		void VirtualCPU::__track_spin_loop(u8 inst, u16 instAddr)
+		{
+			tSpinLoop& loop = m_spinLoop;
+			bool insideLoop = (loop.valid && instAddr >= loop.head && instAddr <= loop.tail);
+			if (loop.confirmed && !insideLoop)
+				__reset_spin_loop();
+			if (inst == data::OpCodes::MovMemReg || inst == data::OpCodes::MovByteMemReg)
+			{
+				if (!insideLoop) return;
+				for (u8 i = 0; i < loop.readCount; i++)
+				{
+					if (loop.reads[i].instructionAddress != instAddr) continue;
+					loop.reads[i].value = readRegister(m_memory.read8(instAddr + 1));
+					break;
+				}
+				return;
+			}
+			if (inst < data::OpCodes::JmpNotEqImm || inst > data::OpCodes::Jmp)
+				return;
+			u16 target = readRegister(data::Registers::IP);
+			if (target > instAddr || instAddr - target > MaxSpinLoopSize)
+			{
+				__reset_spin_loop();
+				return;
+			}
+			if (target != loop.head || instAddr != loop.tail)
+			{
+				loop.head = target;
+				loop.tail = instAddr;
+				loop.valid = __analyze_spin_loop(target, instAddr);
+				__reset_spin_loop();
+			}
+			if (!loop.valid) return;
+			//Two arrivals at the head of the loop with the exact same registers: every further iteration will be identical
+			loop.confirmed = loop.snapshotValid && std::equal(std::begin(m_registers), std::end(m_registers), std::begin(loop.registers));
+			std::copy(std::begin(m_registers), std::end(m_registers), std::begin(loop.registers));
+			loop.snapshotValid = true;
+		}
+
+		bool VirtualCPU::__analyze_spin_loop(u16 head, u16 tail)
+		{
+			//Only loops made of register moves and plain memory reads qualify: they can't change anything
+			// on their own, so they keep spinning until a device or an interrupt changes what they read
+			tSpinLoop& loop = m_spinLoop;
+			loop.readCount = 0;
+			loop.iterationCycles = data::OpCodes::getInstructionCycles(m_memory.read8(tail));
+			if (m_isOffsetAddressingEnabled) return false;
+			u16 addr = head;
+			while (addr < tail)
+			{
+				u8 inst = m_memory.read8(addr);
+				if (inst == data::OpCodes::MovMemReg || inst == data::OpCodes::MovByteMemReg)
+				{
+					u16 readAddr = m_memory.read16(addr + 2);
+					//The timer counts every cycle, reading it is never idle
+					if ((u32)readAddr + 1 >= data::MemoryMapAddresses::Timer_Start && readAddr <= data::MemoryMapAddresses::Timer_End)
+						return false;
+					if (loop.readCount >= MaxSpinLoopReads)
+						return false;
+					tSpinRead& read = loop.reads[loop.readCount++];
+					read.instructionAddress = addr;
+					read.address = readAddr;
+					read.byte = (inst == data::OpCodes::MovByteMemReg);
+					read.value = 0;
+				}
+				else if (inst != data::OpCodes::NoOp && inst != data::OpCodes::MovImmReg && inst != data::OpCodes::MovRegReg)
+					return false;
+				addr += data::OpCodes::getInstructionSIze(inst);
+				loop.iterationCycles += data::OpCodes::getInstructionCycles(inst);
+			}
+			return addr == tail;
+		}
 	}
 }
@@ -15,6 +15,10 @@ namespace dragon
 		class VirtualCPU
 		{
 			public: enum class eDebugProfilerTimeUnits { Millis = 0, Secs = 1, Micros = 2, Nanos = 3 };
+			public:
+				inline static constexpr u16 MaxSpinLoopSize = 64;
+				inline static constexpr u8 MaxSpinLoopReads = 4;
+
 			public:
 				VirtualCPU(IMemoryDevice& memory);
 				i16 readRegister(u8 reg);
@@ -40,16 +44,48 @@ namespace dragon
 				bool execute(void);
 
 				inline bool isHalted(void) const { return m_halt; }
+				inline bool isWaitingForInterrupt(void) const { return m_waitingForInterrupt; }
 				inline u8 getCurrentInstruction(void) const { return m_currentInst; }
 				inline bool isInDebugBreakPoint(void) const { return m_isDebugBreakPoint; }
 				inline bool isRamDumped(void) const { return m_ramDumped; }
 				inline bool isInBIOSMOde(void) const { return m_biosMode; }
 				inline bool isInSubRoutine(void) const { return m_subroutineCounter > 0; }
 				inline i32 getSubRoutineCounter(void) const { return m_subroutineCounter; }
+				inline i32 getInterruptHandlerDepth(void) const { return m_interruptHandlerCount; }
 				inline data::CPUExtension* getCurrentCPUExtension(void) const { return m_currentExtension; }
 				inline u8 getCurrentCPUExtensionInstruction(void) const { return m_currentExtInst; }
 				inline bool isOffsetAddressingModeEnabled(void) const { return m_isOffsetAddressingEnabled; }
 				inline u16 getCurrentOffset(void) const { return m_currentOffset; }
+				inline u64 getCycleCount(void) const { return m_cycleCount; }
+				inline bool isInSpinLoop(void) const { return m_spinLoop.confirmed; }
+				bool isIdle(void);
+				void skipCycles(u64 cycles);
+
+			private: struct tSpinRead
+			{
+				u16 instructionAddress { 0 };
+				u16 address { 0 };
+				bool byte { false };
+				i16 value { 0 };
+			};
+
+			private: struct tSpinLoop
+			{
+				u16 head { 0 };
+				u16 tail { 0 };
+				bool valid { false };
+				bool snapshotValid { false };
+				bool confirmed { false };
+				u16 iterationCycles { 0 };
+				u8 readCount { 0 };
+				tSpinRead reads[MaxSpinLoopReads];
+				i16 registers[20];
+			};
+
+			private:
+				void __track_spin_loop(u8 inst, u16 instAddr);
+				bool __analyze_spin_loop(u16 head, u16 tail);
+				inline void __reset_spin_loop(void) { m_spinLoop.confirmed = false; m_spinLoop.snapshotValid = false; }
 
 			private:
 				i16 m_registers[20];
@@ -57,6 +93,7 @@ namespace dragon
 				IMemoryDevice& m_memory;
 				u16 m_stackFrameSize { 0 };
 				bool m_halt { false };
+				bool m_waitingForInterrupt { false };
 				u8 m_currentInst { 0x00 };
 				u8 m_currentAddr { 0x00 };
 				bool m_biosMode { true };
@@ -69,6 +106,9 @@ namespace dragon
 
 				bool m_isOffsetAddressingEnabled { false };
 				u16 m_currentOffset { 0x0000 };
+				u64 m_cycleCount { 0 };
+				u8 m_stallCycles { 0 };
+				tSpinLoop m_spinLoop;
 
 				data::CPUExtension* m_extensions[16];
 				data::CPUExtension* m_currentExtension { nullptr };
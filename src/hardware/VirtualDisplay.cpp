@@ -2,11 +2,19 @@
 #include <ogfx/render/PixelRenderer.hpp>
 #include "../runtime/DragonRuntime.hpp"
 #include "../tools/GlobalData.hpp"
+#include <cstring>
 
 namespace dragon
 {
 	namespace hw
 	{
+		void VirtualDisplay::setFont(const String& fontPath)
+		{
+			m_font.init(fontPath);
+			text16_build_glyph_cache();
+			m_fullRepaint = true;
+		}
+
 		void VirtualDisplay::onInitialize(void)
 		{
 			m_renderer.initialize(*this);
@@ -18,7 +26,9 @@ namespace dragon
 				m_text16_Currentpalette = m_text16_palettes[0];
 			else
 				m_text16_Currentpalette = m_text16_palettes[m_currentPaletteID];
+			pixel16_load_palette();
 
+			m_singleTextLines.init(ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V, DragonRuntime::machine_config.text_scrollback_lines);
 			text16_init_buffer();
 		}
 
@@ -26,62 +36,97 @@ namespace dragon
 
 		void VirtualDisplay::onRender(void)
 		{
-			if (!isVisible()) return;
+			bool exporting = m_sharedFramebuffer.isOpen();
+			if ((!isVisible() && !exporting) || m_terminal.isActive()) return;
+			if (m_frames.acquire())
+				__draw_snapshot(m_frames.getReadSlot());
+			if (m_pixelsChanged)
+			{
+				if (exporting)
+					m_sharedFramebuffer.publish((const u32*)m_renderer.getScreenPixels());
+				if (isVisible())
+					m_renderer.updateBuffer();
+				m_pixelsChanged = false;
+			}
+			if (isVisible())
+				m_renderer.displayBuffer();
+		}
+
+		bool VirtualDisplay::enableTerminalBackend(void)
+		{
+			if (!m_terminal.start(ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V))
+				return false;
 			auto& config = DragonRuntime::machine_config;
-			auto& mem = DragonRuntime::memMap;
-			u16 vga_addr = data::MemoryMapAddresses::VideoCardInterface_Start;
-			u8 video_mode = mem.read8(vga_addr + tRegisters::VideoMode);
-			if (video_mode == tVideoModeValues::TextSingleColor)
+			m_terminal.setSingleTextColors(config.singleColor_foreground, config.singleColor_background);
+			if (m_text16_Currentpalette != nullptr)
+			{
+				for (u8 i = 0; i <= TerminalDisplay::PaletteSize; i++)
+					m_terminal.setPaletteColor(i, m_text16_Currentpalette->getColor(i));
+			}
+			return true;
+		}
+
+		void VirtualDisplay::disableTerminalBackend(void)
+		{
+			m_terminal.stop();
+		}
+
+		bool VirtualDisplay::renderTerminal(VirtualKeyboard& keyboard)
+		{
+			if (!m_terminal.isActive()) return true;
+			if (!m_terminal.pollInput(keyboard))
+				return false;
+			if (m_frames.acquire())
+				m_terminal.draw(m_frames.getReadSlot());
+			return true;
+		}
+
+		bool VirtualDisplay::enableSharedFramebuffer(const String& name)
+		{
+			u32 width = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * ogfx::PixelRenderer::TextRenderer::FONT_CHAR_W;
+			u32 height = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V * ogfx::PixelRenderer::TextRenderer::FONT_CHAR_H;
+			if (!m_sharedFramebuffer.create(name, width, height, m_pixelRedMask, m_pixelGreenMask, m_pixelBlueMask))
+				return false;
+			m_fullRepaint = true;
+			return true;
+		}
+
+		String VirtualDisplay::getScreenText(void) const
+		{
+			String text = "";
+			const u16 width = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H;
+			if (m_lastVideoMode == tVideoModeValues::TextSingleColor)
 			{
-				u8 invert_colors = mem.read8(vga_addr + tRegisters::TextSingleInvertColors);
-				if (m_refreshScreen)
+				std::vector<char> rows;
+				m_singleTextLines.copyVisible(rows);
+				for (u32 i = 0; i < rows.size(); i++)
 				{
-					if (invert_colors == 0)
-						m_renderer.clear(config.singleColor_background);
-					else
-						m_renderer.clear(config.singleColor_foreground);
-					for (i32 i = 0; i < m_singleTextLines.size(); i++)
-					{
-						auto& line = m_singleTextLines[i];
-						if (invert_colors == 0)
-							ogfx::PixelRenderer::TextRenderer::drawString(line, 0, i, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_foreground, config.singleColor_background);
-						else
-							ogfx::PixelRenderer::TextRenderer::drawString(line, 0, i, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_background, config.singleColor_foreground);
-					}
-					m_refreshScreen = false;
+					text.add(rows[i] == 0 ? ' ' : rows[i]);
+					if ((i + 1) % width == 0)
+						text.add('\n');
 				}
 			}
-			else if (video_mode == tVideoModeValues::Text16Colors)
+			else if (m_lastVideoMode == tVideoModeValues::Text16Colors)
 			{
-				if (m_refreshScreen)
+				for (u32 i = 0; i < m_text16_buffer.size(); i++)
 				{
-					u8 clear_color = mem.read8(vga_addr + tRegisters::ClearColor);
-					ostd::Color clearColor = m_text16_Currentpalette->getColor(clear_color);
-					m_renderer.clear(clearColor);
-					for (i32 i = 0; i < ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V * ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H; i++)
-					{
-						auto& cell = m_text16_buffer[i];
-						ostd::Color background = m_text16_Currentpalette->getColor(cell.backgroundColor);
-						ostd::Color foreground = m_text16_Currentpalette->getColor(cell.foregroundColor);
-						char character = static_cast<char>(cell.character);
-						auto xy = CONVERT_1D_2D(i, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H);
-						ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(character), xy.x, xy.y, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, foreground, background);
-					}
-					m_refreshScreen = false;
+					text.add(m_text16_buffer[i].character == 0 ? ' ' : (char)m_text16_buffer[i].character);
+					if ((i + 1) % width == 0)
+						text.add('\n');
 				}
 			}
+			return text;
+		}
 
+		void VirtualDisplay::update(void)
+		{
+			__process_signal();
 			m_redrawScreen = m_redrawScreen && !DragonRuntime::vGraphicsInterface.readFlag(hw::interface::Graphics::tFlags::ScreenRedrawDisabled);
 			if (m_redrawScreen)
-			{
 				__redraw_screen();
-			}
-			m_renderer.displayBuffer();
 		}
 
-		// static char c = 'A';
-
-		void VirtualDisplay::onUpdate(void)
+		void VirtualDisplay::__process_signal(void)
 		{
 			auto& mem = DragonRuntime::memMap;
 			u16 vga_addr = data::MemoryMapAddresses::VideoCardInterface_Start;
@@ -168,7 +213,6 @@ namespace dragon
 					DragonRuntime::vGraphicsInterface.clearVRAM_16Colors(textCell.character, textCell.backgroundColor, textCell.foregroundColor);
 
 					m_redrawScreen = true;
-					m_refreshScreen = true;
 				}
 				else if (signal == tSignalValues::RedrawScreen)
 				{
@@ -184,83 +228,142 @@ namespace dragon
 					DragonRuntime::vGraphicsInterface.scroll_16Colors();
 					__redraw_screen();
 				}
+				else if (signal == tSignalValues::Text16Color_BlitMemory)
+				{
+					text16_blit_memory();
+				}
+				else if (signal == tSignalValues::Text16Color_FillRect)
+				{
+					u8 character = mem.read8(vga_addr + tRegisters::MemControllerChar);
+					u8 background = mem.read8(vga_addr + tRegisters::MemControllerBGCol);
+					u8 foreground = mem.read8(vga_addr + tRegisters::MemControllerFGCol);
+					u16 x = mem.read16(vga_addr + tRegisters::MemControllerX);
+					u16 y = mem.read16(vga_addr + tRegisters::MemControllerY);
+					u8 width = mem.read8(vga_addr + tRegisters::MemControllerWidth);
+					u8 height = mem.read8(vga_addr + tRegisters::MemControllerHeight);
+					DragonRuntime::vGraphicsInterface.fillVRAM_16Colors(x, y, width, height, character, background, foreground);
+				}
 			}
-			else return;
-			mem.write8(vga_addr + tRegisters::Signal, tSignalValues::Continue);
-		}
-
-		void VirtualDisplay::onFixedUpdate(f64 frameTime_s)
-		{
-			auto& config = DragonRuntime::machine_config;
-			auto& mem = DragonRuntime::memMap;
-			u16 vga_addr = data::MemoryMapAddresses::VideoCardInterface_Start;
-			u8 video_mode = mem.read8(vga_addr + tRegisters::VideoMode);
-			u8 signal = mem.read8(vga_addr + tRegisters::Signal);
-			if (video_mode == tVideoModeValues::Text16Colors)
+			else if (video_mode == tVideoModeValues::Pixel16Colors)
 			{
-				m_refreshScreen = true;
-				dragon::hw::interface::Graphics::tText16_Cell outTextCell;
-				for (i32 i = 0; i < ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V * ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H; i++)
+				if (signal == tSignalValues::Pixel16Color_PlotPixel)
 				{
-					auto xy = CONVERT_1D_2D(i, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H);
-					DragonRuntime::vGraphicsInterface.readVRAM_16Colors(xy.x, xy.y, outTextCell);
-					m_text16_buffer[i] = outTextCell;
+					u16 x = mem.read16(vga_addr + tRegisters::MemControllerX);
+					u16 y = mem.read16(vga_addr + tRegisters::MemControllerY);
+					u8 color = mem.read8(vga_addr + tRegisters::MemControllerFGCol);
+					DragonRuntime::vGraphicsInterface.writePixel_Pixel16(x, y, color);
+				}
+				else if (signal == tSignalValues::Pixel16Color_BlitMemory)
+				{
+					pixel16_blit_memory();
+				}
+				else if (signal == tSignalValues::ClearSCreen)
+				{
+					DragonRuntime::vGraphicsInterface.clearPixels_Pixel16(mem.read8(vga_addr + tRegisters::MemControllerBGCol));
+					m_redrawScreen = true;
+				}
+				else if (signal == tSignalValues::RedrawScreen)
+				{
+					__redraw_screen();
 				}
 			}
+			else return;
+			mem.write8(vga_addr + tRegisters::Signal, tSignalValues::Continue);
 		}
 
 		void VirtualDisplay::__redraw_screen(void)
 		{
-			m_renderer.updateBuffer();
+			__publish_frame();
 			DragonRuntime::cpu.handleInterrupt(data::InterruptCodes::Text16ModeScreenRefreshed, true);
 			m_redrawScreen = false;
-			m_refreshScreen = true;
 		}
 
-		void VirtualDisplay::single_text_add_char_to_line(char c)
+		void VirtualDisplay::__publish_frame(void)
 		{
-			auto& config = DragonRuntime::machine_config;
 			auto& mem = DragonRuntime::memMap;
 			u16 vga_addr = data::MemoryMapAddresses::VideoCardInterface_Start;
-			u8 invert_colors = mem.read8(vga_addr + tRegisters::TextSingleInvertColors);
-			if (m_singleTextLines.size() == 0)
+			u8 video_mode = mem.read8(vga_addr + tRegisters::VideoMode);
+			auto& graphics = DragonRuntime::vGraphicsInterface;
+			if (video_mode != m_lastVideoMode)
 			{
-				m_singleTextLines.push_back(String().addChar(c));
-				if (invert_colors == 0)
-					ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(c), 0, 0, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_foreground, config.singleColor_background);
-				else
-					ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(c), 0, 0, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_background, config.singleColor_foreground);
-				return;
+				m_lastVideoMode = video_mode;
+				graphics.markAllDirty_16Colors();
+				graphics.markAllDirty_Pixel16();
 			}
-			auto& line = m_singleTextLines[m_singleTextLines.size() - 1];
-			if (c == '\n')
-				m_singleTextLines.push_back("");
-			else if (isprint(c))
+			auto& frame = m_frames.getWriteSlot();
+			frame.videoMode = video_mode;
+			frame.forceRepaint = m_forceRepaint;
+			m_forceRepaint = false;
+			if (video_mode == tVideoModeValues::TextSingleColor)
 			{
-				if (line.len() == ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H)
+				frame.invertColors = mem.read8(vga_addr + tRegisters::TextSingleInvertColors) != 0;
+				m_singleTextLines.copyVisible(frame.singleTextRows);
+				frame.singleTextTop = m_singleTextLines.getVisibleTop();
+			}
+			else if (video_mode == tVideoModeValues::Text16Colors)
+			{
+				//Only cells touched since the last frame are copied out of VRAM
+				if (graphics.isFullyDirty_16Colors())
 				{
-					m_singleTextLines.push_back(String().addChar(c));
-					auto& line = m_singleTextLines[m_singleTextLines.size() - 1];
-					if (invert_colors == 0)
-						ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(c), line.len() - 1, m_singleTextLines.size() - 1, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_foreground, config.singleColor_background);
-					else
-						ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(c), line.len() - 1, m_singleTextLines.size() - 1, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_background, config.singleColor_foreground);
+					for (i32 i = 0; i < m_text16_buffer.size(); i++)
+						text16_fetch_cell(i);
 				}
 				else
 				{
-					line.addChar(c);
-					if (invert_colors == 0)
-						ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(c), line.len() - 1, m_singleTextLines.size() - 1, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_foreground, config.singleColor_background);
-					else
-						ogfx::PixelRenderer::TextRenderer::drawString(String().addChar(c), line.len() - 1, m_singleTextLines.size() - 1, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, config.singleColor_background, config.singleColor_foreground);
+					for (auto& cell : graphics.getDirtyCells_16Colors())
+						text16_fetch_cell(cell);
 				}
+				graphics.clearDirtyCells_16Colors();
+				frame.text16Cells = m_text16_buffer;
 			}
-			else return;
-			if (m_singleTextLines.size() == ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V + 1)
+			else if (video_mode == tVideoModeValues::Pixel16Colors)
+			{
+				//Same for the pixel mode, one scanline at a time
+				const u8* vram = graphics.getFrame_Pixel16();
+				if (graphics.isFullyDirty_Pixel16())
+					std::memcpy(m_pixel16_buffer.data(), vram, m_pixel16_buffer.size());
+				else
+				{
+					const u16 line_size = interface::Graphics::tPixel16::LineSizeBytes;
+					for (auto& line : graphics.getDirtyLines_Pixel16())
+						std::memcpy(m_pixel16_buffer.data() + (line * line_size), vram + (line * line_size), line_size);
+				}
+				graphics.clearDirtyLines_Pixel16();
+				frame.pixel16Frame = m_pixel16_buffer;
+			}
+			m_frames.publish();
+			m_publishedFrames++;
+		}
+
+		void VirtualDisplay::__draw_snapshot(const tDisplaySnapshot& snapshot)
+		{
+			bool fullRepaint = m_fullRepaint || snapshot.forceRepaint || snapshot.videoMode != m_drawnVideoMode;
+			m_drawnVideoMode = snapshot.videoMode;
+			m_fullRepaint = false;
+			if (snapshot.videoMode == tVideoModeValues::TextSingleColor)
+				single_text_draw(snapshot, fullRepaint);
+			else if (snapshot.videoMode == tVideoModeValues::Text16Colors)
+				text16_draw(snapshot, fullRepaint);
+			else if (snapshot.videoMode == tVideoModeValues::Pixel16Colors)
+				pixel16_draw(snapshot, fullRepaint);
+		}
+
+		const u8* VirtualDisplay::__gather_memory(u16 source, u16 rowSize, u16 rows, u16 stride)
+		{
+			auto& mem = DragonRuntime::memMap;
+			m_blitBuffer.resize(rowSize * rows);
+			for (u16 row = 0; row < rows; row++)
 			{
-				m_refreshScreen = true;
-				m_singleTextLines.erase(m_singleTextLines.begin());
+				u16 row_addr = source + (row * stride);
+				for (u16 i = 0; i < rowSize; i++)
+					m_blitBuffer[(row * rowSize) + i] = mem.read8(row_addr + i);
 			}
+			return (const u8*)m_blitBuffer.data();
+		}
+
+		void VirtualDisplay::single_text_add_char_to_line(char c)
+		{
+			m_singleTextLines.addChar(c);
 		}
 
 		void VirtualDisplay::single_text_add_char_to_buffer(char c)
@@ -295,19 +398,257 @@ namespace dragon
 		void VirtualDisplay::single_text_clear_screen(void)
 		{
 			m_singleTextLines.clear();
-			m_refreshScreen = true;
 		}
 
 		void VirtualDisplay::single_text_refresh_screen(void)
 		{
-			m_refreshScreen = true;
+			m_forceRepaint = true;
+		}
+
+		void VirtualDisplay::single_text_draw(const tDisplaySnapshot& snapshot, bool fullRepaint)
+		{
+			const u16 width = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H;
+			const u16 rows = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V;
+			if (snapshot.invertColors != m_drawnInvertColors || m_singleText_drawnRows.size() != snapshot.singleTextRows.size())
+			{
+				m_drawnInvertColors = snapshot.invertColors;
+				m_singleText_drawnRows.assign(snapshot.singleTextRows.size(), 0);
+				fullRepaint = true;
+			}
+			//When the text scrolled, move the pixels (and what we know was drawn) up instead of redrawing every row
+			u64 scrolled = snapshot.singleTextTop - m_singleText_drawnTop;
+			if (!fullRepaint && snapshot.singleTextTop > m_singleText_drawnTop && scrolled < rows)
+			{
+				u32* screen = (u32*)m_renderer.getScreenPixels();
+				const u32 text_row_pixels = getWindowWidth() * ogfx::PixelRenderer::TextRenderer::FONT_CHAR_H;
+				std::memmove(screen, screen + (scrolled * text_row_pixels), (rows - scrolled) * text_row_pixels * sizeof(u32));
+				std::memmove(m_singleText_drawnRows.data(), m_singleText_drawnRows.data() + (scrolled * width), (rows - scrolled) * width);
+				std::fill(m_singleText_drawnRows.end() - (scrolled * width), m_singleText_drawnRows.end(), 0);
+				m_pixelsChanged = true;
+			}
+			m_singleText_drawnTop = snapshot.singleTextTop;
+			for (u16 row = 0; row < rows; row++)
+			{
+				const char* text = snapshot.singleTextRows.data() + (row * width);
+				char* drawn = m_singleText_drawnRows.data() + (row * width);
+				if (!fullRepaint && std::memcmp(text, drawn, width) == 0)
+					continue;
+				std::memcpy(drawn, text, width);
+				single_text_draw_row(row, text, snapshot.invertColors);
+				m_pixelsChanged = true;
+			}
 		}
 
+		void VirtualDisplay::single_text_draw_row(u16 row, const char* text, bool invertColors)
+		{
+			const u16 width = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H;
+			if (m_text16_glyphs.isValid())
+			{
+				u32 foreground = (invertColors ? m_singleText_backgroundPixel : m_singleText_foregroundPixel);
+				u32 background = (invertColors ? m_singleText_foregroundPixel : m_singleText_backgroundPixel);
+				for (u16 col = 0; col < width; col++)
+					m_text16_glyphs.drawCellPixels((u32*)m_renderer.getScreenPixels(), getWindowWidth(), col, row, (u8)text[col], foreground, background);
+				return;
+			}
+			auto& config = DragonRuntime::machine_config;
+			m_singleText_rowString = "";
+			for (u16 col = 0; col < width; col++)
+				m_singleText_rowString.addChar(text[col]);
+			const ostd::Color& foreground = (invertColors ? config.singleColor_background : config.singleColor_foreground);
+			const ostd::Color& background = (invertColors ? config.singleColor_foreground : config.singleColor_background);
+			ogfx::PixelRenderer::TextRenderer::drawString(m_singleText_rowString, 0, row, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, foreground, background);
+		}
 
 		void VirtualDisplay::text16_init_buffer(void)
 		{
 			for (i32 i = 0; i < ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V * ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H; i++)
 				m_text16_buffer.push_back({ 0, 0, ' ' });
+			m_pixel16_buffer.resize(interface::Graphics::tPixel16::FrameSizeBytes, 0);
+			for (i32 i = 0; i < 256; i++)
+				m_text16_charStrings.push_back(String().addChar(static_cast<char>(i)));
+		}
+
+		void VirtualDisplay::text16_fetch_cell(u16 index)
+		{
+			auto xy = CONVERT_1D_2D(index, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H);
+			DragonRuntime::vGraphicsInterface.readVRAM_16Colors(xy.x, xy.y, m_text16_buffer[index]);
+		}
+
+		void VirtualDisplay::text16_draw(const tDisplaySnapshot& snapshot, bool fullRepaint)
+		{
+			auto& cells = snapshot.text16Cells;
+			if (m_text16_drawnCells.size() != cells.size())
+			{
+				m_text16_drawnCells.resize(cells.size());
+				fullRepaint = true;
+			}
+			//Cells are diffed against what was last drawn, so frames skipped by the exchange are never lost
+			for (u16 i = 0; i < cells.size(); i++)
+			{
+				auto& cell = cells[i];
+				auto& drawn = m_text16_drawnCells[i];
+				if (!fullRepaint && cell.character == drawn.character && cell.foregroundColor == drawn.foregroundColor && cell.backgroundColor == drawn.backgroundColor)
+					continue;
+				drawn = cell;
+				text16_draw_cell(i, cell);
+				m_pixelsChanged = true;
+			}
+		}
+
+		void VirtualDisplay::text16_draw_cell(u16 index, const hw::interface::Graphics::tText16_Cell& cell)
+		{
+			auto xy = CONVERT_1D_2D(index, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H);
+			if (m_text16_glyphs.isValid())
+			{
+				m_text16_glyphs.drawCell((u32*)m_renderer.getScreenPixels(), getWindowWidth(), xy.x, xy.y, cell.character, cell.foregroundColor, cell.backgroundColor);
+				return;
+			}
+			ostd::Color background = m_text16_Currentpalette->getColor(cell.backgroundColor);
+			ostd::Color foreground = m_text16_Currentpalette->getColor(cell.foregroundColor);
+			ogfx::PixelRenderer::TextRenderer::drawString(m_text16_charStrings[cell.character], xy.x, xy.y, m_renderer.getScreenPixels(), getWindowWidth(), getWindowHeight(), m_font.m_fontPixels, foreground, background);
+		}
+
+		void VirtualDisplay::text16_blit_memory(void)
+		{
+			auto& mem = DragonRuntime::memMap;
+			u16 vga_addr = data::MemoryMapAddresses::VideoCardInterface_Start;
+			u16 x = mem.read16(vga_addr + tRegisters::MemControllerX);
+			u16 y = mem.read16(vga_addr + tRegisters::MemControllerY);
+			u8 width = mem.read8(vga_addr + tRegisters::MemControllerWidth);
+			u8 height = mem.read8(vga_addr + tRegisters::MemControllerHeight);
+			u16 source = mem.read16(vga_addr + tRegisters::MemControllerSource);
+			u16 stride = mem.read16(vga_addr + tRegisters::MemControllerSourceStride);
+			u16 row_size = width * interface::Graphics::tText16_CellStructure::MemorySizeBytes;
+			if (stride == 0)
+				stride = row_size;
+			//Gather the guest buffer once, then hand the whole rectangle to the Graphics interface
+			const u8* cells = __gather_memory(source, row_size, height, stride);
+			DragonRuntime::vGraphicsInterface.blitVRAM_16Colors(x, y, width, height, cells, row_size);
+		}
+
+		void VirtualDisplay::pixel16_blit_memory(void)
+		{
+			auto& mem = DragonRuntime::memMap;
+			u16 vga_addr = data::MemoryMapAddresses::VideoCardInterface_Start;
+			u16 x = mem.read16(vga_addr + tRegisters::MemControllerX);
+			u16 y = mem.read16(vga_addr + tRegisters::MemControllerY);
+			u8 width = mem.read8(vga_addr + tRegisters::MemControllerWidth);
+			u8 height = mem.read8(vga_addr + tRegisters::MemControllerHeight);
+			u16 source = mem.read16(vga_addr + tRegisters::MemControllerSource);
+			u16 stride = mem.read16(vga_addr + tRegisters::MemControllerSourceStride);
+			//Width and stride are in bytes here (two pixels each)
+			if (stride == 0)
+				stride = width;
+			const u8* packed = __gather_memory(source, width, height, stride);
+			DragonRuntime::vGraphicsInterface.blitPixels_Pixel16(x, y, width, height, packed, width);
+		}
+
+		void VirtualDisplay::pixel16_draw(const tDisplaySnapshot& snapshot, bool fullRepaint)
+		{
+			using tPixel16 = interface::Graphics::tPixel16;
+			static_assert(ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * ogfx::PixelRenderer::TextRenderer::FONT_CHAR_W == tPixel16::Width * PixelExpander::HorizontalScale, "Pixel16 mode expects the screen to be twice as wide as the mode.");
+			if (m_pixel16_drawnFrame.size() != snapshot.pixel16Frame.size())
+			{
+				m_pixel16_drawnFrame.resize(snapshot.pixel16Frame.size());
+				fullRepaint = true;
+			}
+			u32* screen = (u32*)m_renderer.getScreenPixels();
+			const u32 screen_w = getWindowWidth();
+			const u16 scale_y = getWindowHeight() / tPixel16::Height;
+			const u32 row_bytes = tPixel16::Width * PixelExpander::HorizontalScale * sizeof(u32);
+			//Only scanlines that changed since the last drawn frame are expanded
+			for (u16 y = 0; y < tPixel16::Height; y++)
+			{
+				const u8* line = snapshot.pixel16Frame.data() + (y * tPixel16::LineSizeBytes);
+				u8* drawn = m_pixel16_drawnFrame.data() + (y * tPixel16::LineSizeBytes);
+				if (!fullRepaint && std::memcmp(line, drawn, tPixel16::LineSizeBytes) == 0)
+					continue;
+				std::memcpy(drawn, line, tPixel16::LineSizeBytes);
+				u32* dest = screen + (y * scale_y * screen_w);
+				m_pixel16_expander.expandLine(dest, line, tPixel16::Width);
+				for (u16 i = 1; i < scale_y; i++)
+					std::memcpy(dest + (i * screen_w), dest, row_bytes);
+				m_pixelsChanged = true;
+			}
+		}
+
+		void VirtualDisplay::pixel16_load_palette(void)
+		{
+			//Pixel modes need no font, so the palette is converted through the renderer itself
+			// instead of through the glyph cache (which is not built if the font fails to load)
+			if (m_text16_Currentpalette == nullptr) return;
+			u32* screen = (u32*)m_renderer.getScreenPixels();
+			for (u8 i = 0; i < PixelExpander::PaletteSize; i++)
+			{
+				m_renderer.clear(m_text16_Currentpalette->getColor(i));
+				m_pixel16_expander.setPaletteColor(i, screen[0]);
+			}
+			m_renderer.clear({ 0, 0, 0 });
+			m_fullRepaint = true;
+		}
+
+		void VirtualDisplay::text16_build_glyph_cache(void)
+		{
+			//Glyphs and palette colors are captured by letting the regular text renderer draw into a one-cell buffer,
+			// so the cache never depends on the font bitmap layout or on the screen pixel format
+			const i32 cell_w = ogfx::PixelRenderer::TextRenderer::FONT_CHAR_W;
+			const i32 cell_h = ogfx::PixelRenderer::TextRenderer::FONT_CHAR_H;
+			if (m_font.m_fontPixels == nullptr || m_text16_Currentpalette == nullptr || !m_text16_glyphs.init(cell_w, cell_h))
+				return;
+			using tPixel = std::remove_pointer_t<decltype(m_renderer.getScreenPixels())>;
+			static_assert(sizeof(tPixel) == sizeof(u32), "GlyphCache expects 32-bit screen pixels.");
+			std::vector<tPixel> cell(cell_w * cell_h);
+			tPixel clear_pixel {  };
+			auto draw = [&](u8 character, const ostd::Color& foreground, const ostd::Color& background) {
+				std::fill(cell.begin(), cell.end(), clear_pixel);
+				ogfx::PixelRenderer::TextRenderer::drawString(m_text16_charStrings[character], 0, 0, cell.data(), cell_w, cell_h, m_font.m_fontPixels, foreground, background);
+			};
+
+			ostd::Color white(255, 255, 255), black(0, 0, 0);
+			draw('A', black, black);
+			clear_pixel = cell[0];
+			draw('A', white, white);
+			tPixel white_pixel = cell[0];
+			for (i32 c = 0; c < 256; c++)
+			{
+				draw(c, white, black);
+				for (i32 y = 0; y < cell_h; y++)
+				{
+					u32 bits = 0;
+					for (i32 x = 0; x < cell_w; x++)
+					{
+						if (cell[(y * cell_w) + x] == white_pixel)
+							bits |= (1u << x);
+					}
+					m_text16_glyphs.setGlyphRow(c, y, bits);
+				}
+			}
+			auto& config = DragonRuntime::machine_config;
+			draw('A', config.singleColor_foreground, config.singleColor_foreground);
+			m_singleText_foregroundPixel = (u32)cell[0];
+			draw('A', config.singleColor_background, config.singleColor_background);
+			m_singleText_backgroundPixel = (u32)cell[0];
+			for (u8 i = 0; i <= GlyphCache::PaletteSize; i++)
+			{
+				ostd::Color color = m_text16_Currentpalette->getColor(i);
+				draw('A', color, color);
+				if (i < GlyphCache::PaletteSize)
+				{
+					m_text16_glyphs.setPaletteColor(i, (u32)cell[0]);
+				}
+				else
+					m_text16_glyphs.setFallbackColor((u32)cell[0]);
+			}
+			//Channel layout of the screen pixels, published along with the shared framebuffer
+			ostd::Color red(255, 0, 0), green(0, 255, 0), blue(0, 0, 255);
+			draw('A', black, black);
+			u32 black_pixel = (u32)cell[0];
+			draw('A', red, red);
+			m_pixelRedMask = (u32)cell[0] ^ black_pixel;
+			draw('A', green, green);
+			m_pixelGreenMask = (u32)cell[0] ^ black_pixel;
+			draw('A', blue, blue);
+			m_pixelBlueMask = (u32)cell[0] ^ black_pixel;
 		}
 
 		void VirtualDisplay::text16_load_palettes(void)
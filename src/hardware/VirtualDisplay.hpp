@@ -3,6 +3,12 @@
 #include <ogfx/gui/Window.hpp>
 #include <ogfx/render/PixelRenderer.hpp>
 #include "../hardware/VirtualIODevices.hpp"
+#include "GlyphCache.hpp"
+#include "PixelExpander.hpp"
+#include "DisplaySnapshot.hpp"
+#include "TextLineRing.hpp"
+#include "TerminalDisplay.hpp"
+#include "SharedFramebuffer.hpp"
 
 namespace dragon
 {
@@ -28,11 +34,16 @@ namespace dragon
 				inline static constexpr u8 MemControllerChar = 0x84;
 				inline static constexpr u8 MemControllerBGCol = 0x85;
 				inline static constexpr u8 MemControllerFGCol = 0x86;
+				inline static constexpr u8 MemControllerWidth = 0x87;
+				inline static constexpr u8 MemControllerHeight = 0x88;
+				inline static constexpr u8 MemControllerSource = 0x89;
+				inline static constexpr u8 MemControllerSourceStride = 0x8B;
 			};
 			public: struct tVideoModeValues
 			{
 				inline static constexpr u8 TextSingleColor = 0x00;
 				inline static constexpr u8 Text16Colors = 0x01;
+				inline static constexpr u8 Pixel16Colors = 0x05;
 			};
 			public: struct tSignalValues
 			{
@@ -48,24 +59,49 @@ namespace dragon
 				inline static constexpr u8 Text16Color_SwapBuffers = 0x10;
 				inline static constexpr u8 Text16Color_WriteMemory = 0x11;
 				inline static constexpr u8 Text16Color_Scroll = 0x12;
+				inline static constexpr u8 Text16Color_BlitMemory = 0x13;
+				inline static constexpr u8 Text16Color_FillRect = 0x14;
+
+				inline static constexpr u8 Pixel16Color_PlotPixel = 0x20;
+				inline static constexpr u8 Pixel16Color_BlitMemory = 0x21;
 
 				inline static constexpr u8 RefreshScreen = 0xE0;
 				inline static constexpr u8 ClearSCreen = 0xE1;
 				inline static constexpr u8 RedrawScreen = 0xE2;
 			};
 			public:
-				inline void setFont(const String& fontPath) { m_font.init(fontPath); }
+				void setFont(const String& fontPath);
 
 				void onInitialize(void) override;
 				void onDestroy(void) override;
 				void onRender(void) override;
-				void onUpdate(void) override;
-				void onFixedUpdate(f64 frameTime_s) override;
 
+				//Called by the emulation thread: handles VGA signals and publishes frames for the render thread
+				void update(void);
 				inline void redrawScreen(void) { m_redrawScreen = true; }
+				//Single color text history (visible lines plus scrollback), owned by the emulation thread
+				inline const TextLineRing& getSingleTextLines(void) const { return m_singleTextLines; }
+				//Emulation thread: number of frames published so far, and the text of the last one (one line per row)
+				inline u64 getPublishedFrameCount(void) const { return m_publishedFrames; }
+				String getScreenText(void) const;
+
+				//Terminal backend: frames are drawn on the host terminal instead of the (hidden) window
+				bool enableTerminalBackend(void);
+				void disableTerminalBackend(void);
+				inline bool isTerminalBackendActive(void) const { return m_terminal.isActive(); }
+				//Called by the render thread; returns false when the user quits from the terminal
+				bool renderTerminal(VirtualKeyboard& keyboard);
+
+				//Exports every changed frame to a shared-memory segment for external viewers (see SharedFramebuffer)
+				bool enableSharedFramebuffer(const String& name);
+				inline void disableSharedFramebuffer(void) { m_sharedFramebuffer.close(); }
 
 			private:
+				void __process_signal(void);
 				void __redraw_screen(void);
+				void __publish_frame(void);
+				void __draw_snapshot(const tDisplaySnapshot& snapshot);
+				const u8* __gather_memory(u16 source, u16 rowSize, u16 rows, u16 stride);
 
 				void single_text_add_char_to_line(char c);
 				void single_text_add_char_to_buffer(char c);
@@ -75,23 +111,60 @@ namespace dragon
 
 				void single_text_clear_screen(void);
 				void single_text_refresh_screen(void);
+				void single_text_draw(const tDisplaySnapshot& snapshot, bool fullRepaint);
+				void single_text_draw_row(u16 row, const char* text, bool invertColors);
 
 				void text16_init_buffer(void);
 				void text16_load_palettes(void);
+				void text16_fetch_cell(u16 index);
+				void text16_draw(const tDisplaySnapshot& snapshot, bool fullRepaint);
+				void text16_draw_cell(u16 index, const hw::interface::Graphics::tText16_Cell& cell);
+				void text16_build_glyph_cache(void);
+				void text16_blit_memory(void);
+
+				void pixel16_load_palette(void);
+				void pixel16_blit_memory(void);
+				void pixel16_draw(const tDisplaySnapshot& snapshot, bool fullRepaint);
 
 			private:
-				ogfx::PixelRenderer m_renderer;
-				ogfx::PixelRenderer::Font m_font;
+				DisplaySnapshotExchange m_frames;
 
-				std::vector<String> m_singleTextLines;
+				//Emulation thread state
+				TextLineRing m_singleTextLines;
 				String m_singleTextBuffer { "" };
-
 				std::vector<hw::interface::Graphics::tText16_Cell> m_text16_buffer;
+				std::vector<u8> m_pixel16_buffer;
+				ostd::ByteStream m_blitBuffer;
+				u8 m_lastVideoMode { 0xFF };
+				u64 m_publishedFrames { 0 };
+				bool m_forceRepaint { true };
+				bool m_redrawScreen { true };
+
+				//Render thread state
+				ogfx::PixelRenderer m_renderer;
+				ogfx::PixelRenderer::Font m_font;
 				std::vector<data::IBiosVideoPalette*> m_text16_palettes;
 				data::IBiosVideoPalette* m_text16_Currentpalette { nullptr };
 				u8 m_currentPaletteID { 0 };
-
-				bool m_redrawScreen { true };
+				std::vector<String> m_text16_charStrings;
+				GlyphCache m_text16_glyphs;
+				std::vector<hw::interface::Graphics::tText16_Cell> m_text16_drawnCells;
+				std::vector<char> m_singleText_drawnRows;
+				u64 m_singleText_drawnTop { 0 };
+				u32 m_singleText_foregroundPixel { 0 };
+				u32 m_singleText_backgroundPixel { 0 };
+				String m_singleText_rowString { "" };
+				PixelExpander m_pixel16_expander;
+				TerminalDisplay m_terminal;
+				SharedFramebuffer m_sharedFramebuffer;
+				u32 m_pixelRedMask { 0 };
+				u32 m_pixelGreenMask { 0 };
+				u32 m_pixelBlueMask { 0 };
+				std::vector<u8> m_pixel16_drawnFrame;
+				u8 m_drawnVideoMode { 0xFF };
+				bool m_drawnInvertColors { false };
+				bool m_fullRepaint { true };
+				bool m_pixelsChanged { true };
 		};
 	}
 }
@@ -9,16 +9,13 @@ namespace dragon
 	{
 		void VirtualHardDrive::init(const String& dataFilePath)
 		{
-			m_dataFile.open(dataFilePath.cpp_str(), std::ios::out | std::ios::in | std::ios::binary);
-			if(!m_dataFile)
+			m_image = DiskImageLoader::open(dataFilePath);
+			if (m_image == nullptr)
 			{
 				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_UnableToMount, String("Unable to mount virtual HardDrive: ").add(dataFilePath));
 				return;
 			}
-			m_fileSize = m_dataFile.tellg();
-			m_dataFile.seekg( 0, std::ios::end );
-			m_fileSize = (i64)m_dataFile.tellg() - m_fileSize;
-			m_dataFile.seekg( 0, std::ios::beg );
+			m_fileSize = m_image->getSize();
 			m_diskID = s_nextDiskID++;
 			m_initialized = true;
 		}
@@ -30,18 +27,18 @@ namespace dragon
 				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_Uninitialized, "Attempt to read uninitialized drive.");
 				return false;
 			}
-			if (addr + size > m_fileSize)
+			if ((u64)addr + size > m_fileSize)
 			{
 				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_ReadOverflow, "Read Overflow on HardDrive.");
 				return false;
 			}
-			u8 cell = 0;
-			outData.clear();
-			m_dataFile.seekg(addr);
-			for (i32 i = 0; i < size; i++)
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			outData.resize(size);
+			if (size == 0) return true;
+			if (!__read_bytes(addr, size, &outData[0]))
 			{
-				m_dataFile.read((char*)&cell, sizeof(cell));
-				outData.push_back(cell);
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_ReadFailed, "Failed to read from HardDrive.");
+				return false;
 			}
 			return true;
 		}
@@ -58,8 +55,34 @@ namespace dragon
 				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteOverflow, "Write Overflow on HardDrive.");
 				return false;
 			}
-			m_dataFile.seekp(addr);
-			m_dataFile.write((char*)(&value), sizeof(value));
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			if (!__write_bytes(addr, sizeof(value), &value))
+			{
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "Failed to write to HardDrive.");
+				return false;
+			}
+			return true;
+		}
+
+		bool VirtualHardDrive::write(u32 addr, const ostd::ByteStream& buffer)
+		{
+			if (!m_initialized)
+			{
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_Uninitialized, "Attempt to write uninitialized drive.");
+				return false;
+			}
+			if ((u64)addr + buffer.size() > m_fileSize)
+			{
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteOverflow, "Write Overflow on HardDrive.");
+				return false;
+			}
+			if (buffer.size() == 0) return true;
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			if (!__write_bytes(addr, buffer.size(), &buffer[0]))
+			{
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "Failed to write to HardDrive.");
+				return false;
+			}
 			return true;
 		}
 
@@ -85,22 +108,63 @@ namespace dragon
 				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_EmptyBuffer, "Buffered Write empty buffer on HardDrive.");
 				return false;
 			}
-			if (addr + m_writeBuffer.size() > m_fileSize)
+			if ((u64)addr + m_writeBuffer.size() > m_fileSize)
 			{
 				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_BuffWriteOverflow, "Buffered Write Overflow on HardDrive.");
 				return false;
 			}
-			m_dataFile.seekp(addr);
-			m_dataFile.write((char*)(&m_writeBuffer[0]), m_writeBuffer.size());
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			bool result = __write_bytes(addr, m_writeBuffer.size(), &m_writeBuffer[0]);
 			m_writeBuffer.clear();
+			if (!result)
+			{
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "Failed to write to HardDrive.");
+				return false;
+			}
 			return true;
 		}
 
+		void VirtualHardDrive::configureCache(const DiskBlockCache::tConfig& config)
+		{
+			if (!m_initialized) return;
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			m_cache.configure(config, *m_image);
+		}
+
+		bool VirtualHardDrive::flush(void)
+		{
+			if (!m_initialized) return true;
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			bool result = m_cache.flush() && m_image->flush();
+			if (!result)
+				data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "Failed to flush HardDrive cache.");
+			return result;
+		}
+
 		void VirtualHardDrive::unmount(void)
 		{
 			if (!m_initialized) return;
-			m_dataFile.close();
+			flush();
+			std::lock_guard<std::mutex> lock(m_ioLock);
+			m_cache.disable();
+			m_image.reset();
 			m_initialized = false;
 		}
+
+		bool VirtualHardDrive::__read_bytes(u64 addr, u32 size, i8* outData)
+		{
+			if (m_cache.isEnabled())
+				return m_cache.read(addr, size, outData);
+			return m_image->readBytes(addr, size, outData);
+		}
+
+		bool VirtualHardDrive::__write_bytes(u64 addr, u32 size, const i8* buffer)
+		{
+			if (m_image->isReadOnly())
+				return false;
+			if (m_cache.isEnabled())
+				return m_cache.write(addr, size, buffer);
+			return m_image->writeBytes(addr, size, buffer);
+		}
 	}
 }
\ No newline at end of file
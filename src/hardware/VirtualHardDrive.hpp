@@ -1,7 +1,8 @@
 #pragma once
 
-#include <fstream>
+#include <mutex>
 #include <ostd/string/String.hpp>
+#include "DiskBlockCache.hpp"
 
 namespace dragon
 {
@@ -12,25 +13,36 @@ namespace dragon
 			public:
 				inline VirtualHardDrive(void) { m_initialized = false; }
 				inline VirtualHardDrive(const String& dataFilePath) { init(dataFilePath); }
+				inline ~VirtualHardDrive(void) { unmount(); }
 				void init(const String& dataFilePath);
 
 				bool read(u32 addr, u16 size, ostd::ByteStream& outData);
 				bool write(u32 addr, i8 value);
+				bool write(u32 addr, const ostd::ByteStream& buffer);
 				void bufferedWrite(i8 value);
 				bool writeBuffer(u32 addr);
 
+				void configureCache(const DiskBlockCache::tConfig& config);
+				bool flush(void);
 				void unmount(void);
 
 				inline bool isInitialized(void) const { return m_initialized; }
 				inline u64 getSize(void) const { return m_fileSize; };
 				inline bool isSame(VirtualHardDrive& vhdd) { return m_diskID == vhdd.m_diskID; }
+				inline const DiskBlockCache::tStats& getCacheStats(void) const { return m_cache.getStats(); }
 
 			private:
-				std::fstream m_dataFile;
+				bool __read_bytes(u64 addr, u32 size, i8* outData);
+				bool __write_bytes(u64 addr, u32 size, const i8* buffer);
+
+			private:
+				std::unique_ptr<IDiskImage> m_image;
 				bool m_initialized { false };
 				u64 m_fileSize { 0 };
 				ostd::ByteStream m_writeBuffer;
 				u32 m_diskID { 0 };
+				std::mutex m_ioLock;
+				DiskBlockCache m_cache;
 
 				inline static u32 s_nextDiskID = 0;
 		};
@@ -3,10 +3,12 @@
 #include "VirtualHardDrive.hpp"
 #include "MemoryMapper.hpp"
 #include "VirtualCPU.hpp"
+#include "WakeupSignal.hpp"
 
 #include "../runtime/DragonRuntime.hpp"
 #include <ogfx/render/PixelRenderer.hpp>
 #include <ostd/io/Memory.hpp>
+#include <cstring>
 
 //TODO: Fix all access functions (reads and writes) ensuring the address is not out of bounds.
 //        Right now the check is done, but just to push an error if out of bounds; the address
@@ -116,6 +118,7 @@ namespace dragon
 			u32 dataSize = data::MemoryMapAddresses::Keyboard_End - data::MemoryMapAddresses::Keyboard_Start + 1;
 			for (i32 i = 0; i < dataSize; i++)
 				m_data.push_back(0x00);
+			m_data[tRegisters::QueueSize] = tQueueEvent::QueueLength;
 			enableSignals();
 			validate();
 			connectSignal(ostd::BuiltinSignals::KeyPressed);
@@ -142,11 +145,22 @@ namespace dragon
 		{
 			if (addr >= m_data.size())
 				data::ErrorHandler::pushError(data::ErrorCodes::IntVector_InvalidAddress, String("Invalid Word KeyboardController location at address: ").add(String::getHexStr(addr, true, 2)));
-			if (!DragonRuntime::cpu.isInBIOSMOde())
+			bool queue_register = (addr == tRegisters::QueueControl || addr == tRegisters::QueueHead);
+			if (!queue_register && !DragonRuntime::cpu.isInBIOSMOde())
 			{
 				data::ErrorHandler::pushError(data::ErrorCodes::AccessViolation_BiosModeRequired, String("Attempting to write byte to KeyboardController while not in BIOS mode. Address: ").add(String::getHexStr(addr, true, 2)));
 				return 0;
 			}
+			if (addr == tRegisters::QueueControl && (u8)value == tQueueControlValues::Enabled)
+			{
+				//Enabling the queue starts from an empty ring
+				__write8(tRegisters::QueueHead, 0);
+				__write8(tRegisters::QueueTail, 0);
+				__write8(tRegisters::QueueSize, tQueueEvent::QueueLength);
+				__write16(tRegisters::QueueDropped, 0);
+			}
+			else if (addr == tRegisters::QueueHead)
+				value = (i8)((u8)value % tQueueEvent::QueueLength);
 			return __write8(addr, value);
 		}
 
@@ -169,27 +183,97 @@ namespace dragon
 
 		void VirtualKeyboard::handleSignal(ostd::Signal& signal)
 		{
-			auto& cpu = DragonRuntime::cpu;
-			const auto& state = SDL_GetKeyboardState(nullptr);
+			tPendingEvent event;
 			if (signal.ID == ostd::BuiltinSignals::KeyPressed || signal.ID == ostd::BuiltinSignals::KeyReleased)
 			{
 				ogfx::KeyEventData& ked = (ogfx::KeyEventData&)signal.userData;
-				m_modifiersBitFiels = __construct_modifiers_bitfield();
-				__write16(tRegisters::Modifiers, (i16)m_modifiersBitFiels.value);
-				__write16(tRegisters::KeyCode, __sdl_key_code_convert(ked.keyCode));
+				event.modifiers = __construct_modifiers_bitfield().value;
+				event.keyCode = __sdl_key_code_convert(ked.keyCode);
 				if (ked.eventType == ogfx::KeyEventData::eKeyEvent::Pressed)
-					cpu.handleInterrupt(data::InterruptCodes::KeyPressed, true);
-				else if (ked.eventType == ogfx::KeyEventData::eKeyEvent::Pressed)
-					cpu.handleInterrupt(data::InterruptCodes::KeyReleased, true);
+				{
+					event.interrupt = data::InterruptCodes::KeyPressed;
+					event.raiseInterrupt = true;
+				}
+				else if (ked.eventType == ogfx::KeyEventData::eKeyEvent::Released)
+				{
+					event.interrupt = data::InterruptCodes::KeyReleased;
+					event.raiseInterrupt = true;
+				}
 			}
 			else if (signal.ID == ostd::BuiltinSignals::TextEntered)
 			{
 				ogfx::KeyEventData& ked = (ogfx::KeyEventData&)signal.userData;
-				m_modifiersBitFiels = __construct_modifiers_bitfield();
-				__write16(tRegisters::Modifiers, (i16)m_modifiersBitFiels.value);
-				__write16(tRegisters::KeyCode, (i16)ked.text[0]);
-				cpu.handleInterrupt(data::InterruptCodes::TextEntered, true);
+				event.modifiers = __construct_modifiers_bitfield().value;
+				event.keyCode = (i16)ked.text[0];
+				event.interrupt = data::InterruptCodes::TextEntered;
+				event.raiseInterrupt = true;
 			}
+			else return;
+			std::lock_guard<std::mutex> lock(m_pendingEventsMutex);
+			m_pendingEvents.push_back(event);
+			m_hasPendingEvents.store(true, std::memory_order_release);
+			WakeupSignal::notify();
+		}
+
+		void VirtualKeyboard::queueKeyEvent(i16 keyCode, u16 modifiers, u8 interrupt)
+		{
+			tPendingEvent event;
+			event.modifiers = modifiers;
+			event.keyCode = keyCode;
+			event.interrupt = interrupt;
+			event.raiseInterrupt = true;
+			std::lock_guard<std::mutex> lock(m_pendingEventsMutex);
+			m_pendingEvents.push_back(event);
+			m_hasPendingEvents.store(true, std::memory_order_release);
+			WakeupSignal::notify();
+		}
+
+		void VirtualKeyboard::processPendingEvents(void)
+		{
+			if (m_hasPendingEvents.load(std::memory_order_acquire))
+			{
+				std::lock_guard<std::mutex> lock(m_pendingEventsMutex);
+				m_processedEvents.insert(m_processedEvents.end(), m_pendingEvents.begin(), m_pendingEvents.end());
+				m_pendingEvents.clear();
+				m_hasPendingEvents.store(false, std::memory_order_relaxed);
+			}
+			if (m_processedEvents.empty())
+				return;
+			auto& cpu = DragonRuntime::cpu;
+			//With the queue enabled every event is stored in the ring and the whole batch raises a single interrupt
+			bool queue_enabled = (u8)m_data[tRegisters::QueueControl] == tQueueControlValues::Enabled;
+			if (queue_enabled)
+			{
+				bool queued = false;
+				for (auto& event : m_processedEvents)
+				{
+					m_modifiersBitFiels.value = event.modifiers;
+					if (!event.raiseInterrupt)
+						continue;
+					__queue_push(event);
+					queued = true;
+				}
+				m_processedEvents.clear();
+				m_legacyEventInFlight = false;
+				if (queued)
+					cpu.handleInterrupt(data::InterruptCodes::KeyboardEventsQueued, true);
+				return;
+			}
+			//Otherwise the KeyCode/Modifiers registers hold a single event: the next one is only delivered
+			// once the handler of the previous one has returned, so its registers are never overwritten early
+			if (m_legacyEventInFlight && cpu.getInterruptHandlerDepth() > m_legacyHandlerDepth)
+				return;
+			m_legacyEventInFlight = false;
+			tPendingEvent event = m_processedEvents.front();
+			m_processedEvents.pop_front();
+			m_modifiersBitFiels.value = event.modifiers;
+			__write16(tRegisters::Modifiers, (i16)event.modifiers);
+			__write16(tRegisters::KeyCode, event.keyCode);
+			if (!event.raiseInterrupt)
+				return;
+			m_legacyHandlerDepth = cpu.getInterruptHandlerDepth();
+			cpu.handleInterrupt(event.interrupt, true);
+			m_legacyEventInFlight = (cpu.getInterruptHandlerDepth() > m_legacyHandlerDepth);
 		}
 
 		ostd::BitField_16 VirtualKeyboard::__construct_modifiers_bitfield(void)
@@ -223,6 +307,27 @@ namespace dragon
 			return value;
 		}
 
+		void VirtualKeyboard::__queue_push(const tPendingEvent& event)
+		{
+			u8 head = (u8)m_data[tRegisters::QueueHead] % tQueueEvent::QueueLength;
+			u8 tail = (u8)m_data[tRegisters::QueueTail] % tQueueEvent::QueueLength;
+			u8 next = (tail + 1) % tQueueEvent::QueueLength;
+			if (next == head)
+			{
+				//Full: the event is dropped and counted, the guest still gets the interrupt to drain the ring
+				u16 dropped = ((u8)m_data[tRegisters::QueueDropped] << 8) | (u8)m_data[tRegisters::QueueDropped + 1];
+				if (dropped < 0xFFFF)
+					__write16(tRegisters::QueueDropped, (i16)(dropped + 1));
+				return;
+			}
+			u16 entry = tRegisters::QueueEvents + (tail * tQueueEvent::SizeBytes);
+			__write8(entry + tQueueEvent::Type, (i8)event.interrupt);
+			__write8(entry + tQueueEvent::Type + 1, 0);
+			__write16(entry + tQueueEvent::Modifiers, (i16)event.modifiers);
+			__write16(entry + tQueueEvent::KeyCode, event.keyCode);
+			__write8(tRegisters::QueueTail, (i8)next);
+		}
+
 		i16 VirtualKeyboard::__sdl_key_code_convert(i32 keyCode)
 		{
 			switch (keyCode)
@@ -466,7 +571,7 @@ namespace dragon
 
 			i8 Disk::write8(u16 addr, i8 value)
 			{
-				if (addr >= tRegisters::FirstReadOnly)
+				if (__is_read_only(addr, 1))
 				{
 					data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_ControllerWriteFailed, "Attempt to write byte to ReadOnly part of HardDrive Controller");
 					return 0;
@@ -481,7 +586,7 @@ namespace dragon
 
 			i16 Disk::write16(u16 addr, i16 value)
 			{
-				if (addr >= tRegisters::FirstReadOnly)
+				if (__is_read_only(addr, 2))
 				{
 					data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_ControllerWriteFailed, "Attempt to write word to ReadOnly part of HardDrive Controller");
 					return 0;
@@ -509,95 +614,52 @@ namespace dragon
 					{
 						m_data.w_Byte(tRegisters::Status, tStatusValues::Free);
 						m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
+						m_activeRequest = 0;
 						m_busy = false;
-						return;
 					}
-					if (signal != tSignalValues::Ignore)
+					else if (signal != tSignalValues::Ignore)
 					{
 						data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_InvalidConfiguration, "Invalid HardDrive configuration: <signal> register must be set to <ignore> while busy.");
+						m_activeRequest = 0;
 						m_busy = false;
 						return;
 					}
-					u8 status = 0;
-					m_data.r_Byte(tRegisters::Status, (i8&)status);
-					if (status == tStatusValues::Free)
-					{
-						data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_InvalidConfiguration, "Invalid HardDrive configuration: <status> register set to <free> while busy.");
-						m_busy = false;
-						return;
-					}
-					u8 currentDisk = 0;
-					u16 currentSector = 0, currentAddress = 0, restDataSize = 0, memoryAddress = 0;
-					m_data.r_Byte(tRegisters::CurrentDisk, (i8&)currentDisk);
-					m_data.r_Word(tRegisters::CurrentSector, (i16&)currentSector);
-					m_data.r_Word(tRegisters::CurrentAddress, (i16&)currentAddress);
-					m_data.r_Word(tRegisters::RestDataSize, (i16&)restDataSize);
-					m_data.r_Word(tRegisters::SourceData, (i16&)memoryAddress);
-					if (m_connectedDisks.count((data::VDiskID)currentDisk) == 0)
-					{
-						data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_InvalidDiskSelected, "Invalid HardDrive configuration: selected Disk not found.");
-						m_busy = false;
-						return;
-					}
-					auto& disk = *m_connectedDisks[currentDisk];
-					u32 hddAddress = 0;
-					if (currentAddress == 0xFFFF)
-					{
-						if (currentSector == 0xFFFF)
-						{
-							data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_EndOfDisk, "HardDrive Error: Reached end of selected Disk.");
-							m_busy = false;
-							return;
-						}
-						currentSector++;
-						currentAddress = 0x0000;
-					}
-					hddAddress = (currentSector << 16) | currentAddress;
-					if (status == tStatusValues::Reading)
-					{
-						ostd::ByteStream _data;
-						if (!disk.read(hddAddress, 1, _data))
-						{
-							data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_ReadFailed, "HardDrive Error: Failed to read data.");
-							m_busy = false;
-							return;
-						}
-						m_memory.write8(memoryAddress, _data[0]);
-					}
-					else if (status == tStatusValues::Writing)
-					{
-						i8 dataRead = m_memory.read8(memoryAddress);
-						if (!disk.write(hddAddress, dataRead))
-						{
-							data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "HardDrive Error: Failed to write data.");
-							m_busy = false;
-							return;
-						}
-					}
-					memoryAddress++;
-					if (memoryAddress == 0xFFFF)
-					{
-						data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_MemoryOverflow, "HardDrive Error: Reached end of Memory.");
-						m_busy = false;
-						return;
-					}
-					restDataSize--;
-					if (restDataSize == 0)
-					{
-						m_data.w_Byte(tRegisters::Status, tStatusValues::Free);
-						m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
-						m_busy = false;
-						m_cpu.handleInterrupt(data::InterruptCodes::DiskInterfaceFFinished, true);
-						return;
-					}
-					currentAddress++;
-					m_data.w_Word(tRegisters::CurrentSector, currentSector);
-					m_data.w_Word(tRegisters::CurrentAddress, currentAddress);
-					m_data.w_Word(tRegisters::RestDataSize, restDataSize);
-					m_data.w_Word(tRegisters::SourceData, memoryAddress);
-					return;
 				}
-				if (signal != tSignalValues::Start) return;
+				else if (signal == tSignalValues::Start)
+					__start_transfer();
+				__submit_queued_commands();
+				__poll_completions();
+			}
+
+			u8 Disk::__build_request(u8 mode, u8 disk, u16 sector, u16 address, u16 size, u16 memoryAddress, DiskIOEngine::tRequest& outRequest)
+			{
+				if (mode != tModeValues::Read && mode != tModeValues::Write)
+					return tQueueStatusValues::InvalidMode;
+				if (m_connectedDisks.count((data::VDiskID)disk) == 0)
+					return tQueueStatusValues::InvalidDisk;
+				u32 hddAddress = ((u32)sector << 16) | address;
+				if ((u64)hddAddress + size > 0x100000000)
+					return tQueueStatusValues::EndOfDisk;
+				if ((u32)memoryAddress + size >= 0xFFFF)
+					return tQueueStatusValues::MemoryOverflow;
+
+				outRequest.disk = m_connectedDisks[disk];
+				outRequest.diskAddress = hddAddress;
+				outRequest.size = size;
+				if (mode == tModeValues::Read)
+					outRequest.operation = DiskIOEngine::eOperation::Read;
+				else
+				{
+					outRequest.operation = DiskIOEngine::eOperation::Write;
+					outRequest.data.resize(size);
+					for (u16 i = 0; i < size; i++)
+						outRequest.data[i] = m_memory.read8(memoryAddress + i);
+				}
+				return tQueueStatusValues::Success;
+			}
+
+			void Disk::__start_transfer(void)
+			{
 				u8 mode = 0, disk = 0;
 				u16 sector = 0, address = 0, size = 0, srcAddr = 0;
 				m_data.r_Byte(tRegisters::ModeSelector, (i8&)mode);
@@ -621,11 +683,211 @@ namespace dragon
 				m_data.w_Word(tRegisters::CurrentAddress, address);
 				m_data.w_Word(tRegisters::RestDataSize, size);
 				m_data.w_Word(tRegisters::SourceData, srcAddr);
-
 				m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
+
+				DiskIOEngine::tRequest request;
+				u8 status = __build_request(mode, disk, sector, address, size, srcAddr, request);
+				if (status == tQueueStatusValues::InvalidDisk)
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_InvalidDiskSelected, "Invalid HardDrive configuration: selected Disk not found.");
+					return;
+				}
+				if (status == tQueueStatusValues::EndOfDisk)
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_EndOfDisk, "HardDrive Error: Reached end of selected Disk.");
+					return;
+				}
+				if (status == tQueueStatusValues::MemoryOverflow)
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_MemoryOverflow, "HardDrive Error: Reached end of Memory.");
+					return;
+				}
+				m_activeRequest = __submit(request, disk, DiskTraceFile::tSourceValues::Registers);
 				m_busy = true;
 			}
 
+			void Disk::__finish_transfer(DiskIOEngine::tRequest& request)
+			{
+				m_activeRequest = 0;
+				m_busy = false;
+				if (!request.success)
+				{
+					if (request.operation == DiskIOEngine::eOperation::Read)
+						data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_ReadFailed, "HardDrive Error: Failed to read data.");
+					else
+						data::ErrorHandler::pushError(data::ErrorCodes::HardDrive_WriteFailed, "HardDrive Error: Failed to write data.");
+					return;
+				}
+				u16 memoryAddress = 0;
+				m_data.r_Word(tRegisters::SourceData, (i16&)memoryAddress);
+				if (request.operation == DiskIOEngine::eOperation::Read)
+				{
+					for (u16 i = 0; i < request.size; i++)
+						m_memory.write8(memoryAddress + i, request.data[i]);
+				}
+				u32 endAddress = request.diskAddress + request.size;
+				m_data.w_Word(tRegisters::CurrentSector, (u16)(endAddress >> 16));
+				m_data.w_Word(tRegisters::CurrentAddress, (u16)(endAddress & 0xFFFF));
+				m_data.w_Word(tRegisters::RestDataSize, 0);
+				m_data.w_Word(tRegisters::SourceData, memoryAddress + request.size);
+				m_data.w_Byte(tRegisters::Status, tStatusValues::Free);
+				m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
+				m_cpu.handleInterrupt(data::InterruptCodes::DiskInterfaceFFinished, true);
+			}
+
+			void Disk::__submit_queued_commands(void)
+			{
+				u8 control = tQueueControlValues::Disabled;
+				m_data.r_Byte(tRegisters::QueueControl, (i8&)control);
+				if (control != tQueueControlValues::Enabled)
+				{
+					if (m_queueEnabled)
+					{
+						m_queuedCommands.clear();
+						m_queueEnabled = false;
+					}
+					return;
+				}
+				u8 queueSize = 0, head = 0, tail = 0;
+				u16 submissionBase = 0;
+				m_data.r_Byte(tRegisters::QueueSize, (i8&)queueSize);
+				m_data.r_Word(tRegisters::QueueSubmissionBase, (i16&)submissionBase);
+				if (!m_queueEnabled)
+				{
+					m_data.w_Byte(tRegisters::QueueSubmissionHead, 0);
+					m_data.w_Byte(tRegisters::QueueCompletionHead, 0);
+					m_data.w_Byte(tRegisters::QueueCompletionTail, 0);
+					m_data.w_Byte(tRegisters::QueueInFlight, 0);
+					m_completionPhase = 1;
+					m_queueEnabled = true;
+				}
+				if (queueSize == 0) return;
+				u8 completionHead = 0, completionTail = 0;
+				m_data.r_Byte(tRegisters::QueueSubmissionHead, (i8&)head);
+				m_data.r_Byte(tRegisters::QueueDoorbell, (i8&)tail);
+				m_data.r_Byte(tRegisters::QueueCompletionHead, (i8&)completionHead);
+				m_data.r_Byte(tRegisters::QueueCompletionTail, (i8&)completionTail);
+				if (tail >= queueSize || completionHead >= queueSize) return;
+				//Every accepted command owns a completion slot until the guest moves CompletionHead past it, and one slot always
+				// stays empty (CompletionHead == CompletionTail means empty): a full ring stalls submissions instead of being overwritten
+				u32 unreadCompletions = (completionTail + queueSize - completionHead) % queueSize;
+				while (head != tail && m_queuedCommands.size() + unreadCompletions < (u32)queueSize - 1)
+				{
+					u16 descriptor = submissionBase + (head * tQueueDescriptor::SizeBytes);
+					tQueuedCommand command;
+					command.tag = m_memory.read16(descriptor + tQueueDescriptor::Tag);
+					command.memoryAddress = m_memory.read16(descriptor + tQueueDescriptor::MemoryAddress);
+					u8 mode = m_memory.read8(descriptor + tQueueDescriptor::Mode);
+					u8 disk = m_memory.read8(descriptor + tQueueDescriptor::Disk);
+					u16 sector = m_memory.read16(descriptor + tQueueDescriptor::Sector);
+					u16 address = m_memory.read16(descriptor + tQueueDescriptor::Address);
+					u16 size = m_memory.read16(descriptor + tQueueDescriptor::DataSize);
+					head = (head + 1) % queueSize;
+
+					DiskIOEngine::tRequest request;
+					u8 status = __build_request(mode, disk, sector, address, size, command.memoryAddress, request);
+					if (status != tQueueStatusValues::Success)
+					{
+						__post_completion(command.tag, status);
+						unreadCompletions++;
+						continue;
+					}
+					m_queuedCommands[__submit(request, disk, DiskTraceFile::tSourceValues::Queue)] = command;
+				}
+				m_data.w_Byte(tRegisters::QueueSubmissionHead, head);
+				m_data.w_Byte(tRegisters::QueueInFlight, (u8)m_queuedCommands.size());
+			}
+
+			void Disk::__poll_completions(void)
+			{
+				DiskIOEngine::tRequest request;
+				while (m_ioEngine.pollCompletion(request))
+				{
+					__record_completion(request);
+					if (m_busy && request.id == m_activeRequest)
+					{
+						__finish_transfer(request);
+						continue;
+					}
+					auto it = m_queuedCommands.find(request.id);
+					if (it == m_queuedCommands.end())
+						continue;
+					tQueuedCommand command = it->second;
+					m_queuedCommands.erase(it);
+					if (request.success && request.operation == DiskIOEngine::eOperation::Read)
+					{
+						for (u16 i = 0; i < request.size; i++)
+							m_memory.write8(command.memoryAddress + i, request.data[i]);
+					}
+					__post_completion(command.tag, request.success ? tQueueStatusValues::Success : tQueueStatusValues::IOError);
+				}
+				if (!m_queueEnabled) return;
+				m_data.w_Byte(tRegisters::QueueInFlight, (u8)m_queuedCommands.size());
+				if (m_queueCompletionsPosted && m_queuedCommands.size() == 0)
+				{
+					m_queueCompletionsPosted = false;
+					m_cpu.handleInterrupt(data::InterruptCodes::DiskQueueBatchFinished, true);
+				}
+			}
+
+			void Disk::__post_completion(u16 tag, u8 status)
+			{
+				u8 queueSize = 0, tail = 0;
+				u16 completionBase = 0;
+				m_data.r_Byte(tRegisters::QueueSize, (i8&)queueSize);
+				m_data.r_Word(tRegisters::QueueCompletionBase, (i16&)completionBase);
+				m_data.r_Byte(tRegisters::QueueCompletionTail, (i8&)tail);
+				if (queueSize == 0) return;
+				u16 entry = completionBase + (tail * tQueueCompletion::SizeBytes);
+				m_memory.write16(entry + tQueueCompletion::Tag, tag);
+				m_memory.write8(entry + tQueueCompletion::Status, status);
+				m_memory.write8(entry + tQueueCompletion::Phase, m_completionPhase);
+				tail++;
+				if (tail >= queueSize)
+				{
+					tail = 0;
+					m_completionPhase ^= 1;
+				}
+				m_data.w_Byte(tRegisters::QueueCompletionTail, tail);
+				m_queueCompletionsPosted = true;
+			}
+
+			u32 Disk::__submit(DiskIOEngine::tRequest& request, u8 disk, u8 source)
+			{
+				tRequestTiming timing;
+				timing.disk = disk;
+				timing.source = source;
+				timing.startCycle = m_cpu.getCycleCount();
+				timing.startTime = std::chrono::steady_clock::now();
+				u32 id = m_ioEngine.submit(std::move(request));
+				m_requestTimings[id] = timing;
+				return id;
+			}
+
+			void Disk::__record_completion(const DiskIOEngine::tRequest& request)
+			{
+				auto it = m_requestTimings.find(request.id);
+				if (it == m_requestTimings.end()) return;
+				tRequestTiming timing = it->second;
+				m_requestTimings.erase(it);
+				bool write = request.operation == DiskIOEngine::eOperation::Write;
+				u64 cycles = m_cpu.getCycleCount() - timing.startCycle;
+				u64 wallTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - timing.startTime).count();
+				m_stats[timing.disk].addSample(write, request.size, request.success, cycles, wallTimeNs);
+				if (!m_trace.isOpen()) return;
+				DiskTraceFile::tRecord record;
+				record.disk = timing.disk;
+				record.write = write;
+				record.success = request.success;
+				record.source = timing.source;
+				record.address = request.diskAddress;
+				record.size = request.size;
+				record.startCycle = timing.startCycle;
+				record.endCycle = m_cpu.getCycleCount();
+				record.wallTimeNs = wallTimeNs;
+				m_trace.record(record);
+			}
+
 			bool Disk::connectDisk(VirtualHardDrive& hdd, data::VDiskID disk_id)
 			{
 				for (auto& disk : m_connectedDisks)
@@ -664,6 +926,11 @@ namespace dragon
 				m_16Color_frameSize = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V * m_16Color_cellSize;
 				m_16Color_currentFrameAddr = m_vramStart;
 				m_16Color_secondFrameAddr = m_vramStart + m_16Color_frameSize;
+				m_16Color_dirtyMap.resize(ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V, false);
+				m_16Color_frameDiffMap.resize(ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V, false);
+				//The pixel mode shares VRAM with the Text16 frames, only one of them is in use at a time
+				m_pixel16_frameAddr = m_vramStart;
+				m_pixel16_dirtyMap.resize(tPixel16::Height, false);
 			}
 
 			i8 Graphics::read8(u16 addr)
@@ -737,45 +1004,42 @@ namespace dragon
 
 			bool Graphics::readVRAM_16Colors(u8 x, u8 y, Graphics::tText16_Cell& outTextCell)
 			{
-				u16 cellOffset = static_cast<u16>(CONVERT_2D_1D(x, y, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H)) * 4;
-				cellOffset += m_16Color_currentFrameAddr;
-				i8 outVal = 0;
-				if (!m_videoMemory.r_Byte(cellOffset + tText16_CellStructure::character, outVal))
+				if (x >= ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H || y >= ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V)
 					return false; //TODO: Error
-				outTextCell.character = outVal;
-				if (!m_videoMemory.r_Byte(cellOffset + tText16_CellStructure::background, outVal))
-					return false; //TODO: Error
-				outTextCell.backgroundColor = outVal;
-				if (!m_videoMemory.r_Byte(cellOffset + tText16_CellStructure::foreground, outVal))
-					return false; //TODO: Error
-				outTextCell.foregroundColor = outVal;
+				u16 cell = static_cast<u16>(CONVERT_2D_1D(x, y, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H));
+				const i8* src = __frame_16Colors(m_16Color_currentFrameAddr) + (cell * m_16Color_cellSize);
+				outTextCell.character = src[tText16_CellStructure::character];
+				outTextCell.backgroundColor = src[tText16_CellStructure::background];
+				outTextCell.foregroundColor = src[tText16_CellStructure::foreground];
 				return true;
 			}
 
 			bool Graphics::writeVRAM_16Colors(u8 x, u8 y, u8 character, u8 background, u8 foreground)
 			{
-				u16 cellOffset = static_cast<u16>(CONVERT_2D_1D(x, y, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H)) * 4;
-				if (!readFlag(tFlags::DoubleBufferingEnabled))
-					cellOffset += m_16Color_currentFrameAddr;
-				else
-					cellOffset += m_16Color_secondFrameAddr;
-				if (!m_videoMemory.w_Byte(cellOffset + tText16_CellStructure::character, character))
-					return false; //TODO: Error
-				if (!m_videoMemory.w_Byte(cellOffset + tText16_CellStructure::background, background))
-					return false; //TODO: Error
-				if (!m_videoMemory.w_Byte(cellOffset + tText16_CellStructure::foreground, foreground))
+				if (x >= ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H || y >= ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V)
 					return false; //TODO: Error
+				u16 cell = static_cast<u16>(CONVERT_2D_1D(x, y, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H));
+				bool front = false;
+				i8* dest = __frame_16Colors(__target_frame_16Colors(front)) + (cell * m_16Color_cellSize);
+				dest[tText16_CellStructure::character] = character;
+				dest[tText16_CellStructure::background] = background;
+				dest[tText16_CellStructure::foreground] = foreground;
+				__mark_frame_diff_16Colors(cell);
+				if (front)
+					__mark_dirty_16Colors(cell);
 				return true;
 			}
 
 			bool Graphics::clearVRAM_16Colors(u8 character, u8 background, u8 foreground)
 			{
-				for (i32 i = m_16Color_currentFrameAddr; i < m_16Color_currentFrameAddr + m_16Color_frameSize; i += 4)
-				{
-					m_videoMemory.w_Byte(i + tText16_CellStructure::character, character);
-					m_videoMemory.w_Byte(i + tText16_CellStructure::background, background);
-					m_videoMemory.w_Byte(i + tText16_CellStructure::foreground, foreground);
-				}
+				i8* frame = __frame_16Colors(m_16Color_currentFrameAddr);
+				frame[tText16_CellStructure::character] = character;
+				frame[tText16_CellStructure::foreground] = foreground;
+				frame[tText16_CellStructure::background] = background;
+				frame[tText16_CellStructure::reserved] = 0;
+				__replicate_cell_16Colors(frame, m_16Color_frameSize);
+				m_16Color_framesDiverged = true;
+				m_16Color_allDirty = true;
 				return true;
 			}
 
@@ -783,40 +1047,220 @@ namespace dragon
 			{
 				if (!readFlag(tFlags::DoubleBufferingEnabled))
 					return;
-				for (i32 i = m_16Color_currentFrameAddr, j = 0; i < m_16Color_currentFrameAddr + m_16Color_frameSize; i += 4, j += 4)
+				std::swap(m_16Color_currentFrameAddr, m_16Color_secondFrameAddr);
+				const i8* front = __frame_16Colors(m_16Color_currentFrameAddr);
+				const i8* back = __frame_16Colors(m_16Color_secondFrameAddr);
+				if (m_16Color_framesDiverged)
 				{
-					i8 outByte = 0;
-					m_videoMemory.r_Byte(m_16Color_secondFrameAddr + j, outByte);
-					m_videoMemory.w_Byte(i + tText16_CellStructure::character, outByte);
-					m_videoMemory.r_Byte(m_16Color_secondFrameAddr + j + 1, outByte);
-					m_videoMemory.w_Byte(i + tText16_CellStructure::background, outByte);
-					m_videoMemory.r_Byte(m_16Color_secondFrameAddr + j + 2, outByte);
-					m_videoMemory.w_Byte(i + tText16_CellStructure::foreground, outByte);
+					//A whole frame was rewritten in place (clear/scroll): compare once to get back to an exact list
+					m_16Color_allDirty = true;
+					m_16Color_framesDiverged = false;
+					for (u16 cell = 0; cell < m_16Color_frameDiffMap.size(); cell++)
+					{
+						bool differs = std::memcmp(front + (cell * m_16Color_cellSize), back + (cell * m_16Color_cellSize), m_16Color_cellSize) != 0;
+						if (differs && !m_16Color_frameDiffMap[cell])
+							m_16Color_frameDiffCells.push_back(cell);
+						m_16Color_frameDiffMap[cell] = differs;
+					}
+					std::erase_if(m_16Color_frameDiffCells, [this](u16 cell) { return !m_16Color_frameDiffMap[cell]; });
+				}
+				else
+				{
+					//Only cells that may differ between the two frames need to be re-rasterized;
+					//the ones that turn out to be equal again can be dropped from the list
+					u32 kept = 0;
+					for (auto& cell : m_16Color_frameDiffCells)
+					{
+						if (std::memcmp(front + (cell * m_16Color_cellSize), back + (cell * m_16Color_cellSize), m_16Color_cellSize) == 0)
+						{
+							m_16Color_frameDiffMap[cell] = false;
+							continue;
+						}
+						__mark_dirty_16Colors(cell);
+						m_16Color_frameDiffCells[kept++] = cell;
+					}
+					m_16Color_frameDiffCells.resize(kept);
+				}
+				if (readFlag(tFlags::SwapCopiesFrontBuffer))
+				{
+					//Legacy behaviour: the new back buffer starts out as a copy of what is on screen
+					std::memcpy(__frame_16Colors(m_16Color_secondFrameAddr), __frame_16Colors(m_16Color_currentFrameAddr), m_16Color_frameSize);
+					__clear_frame_diff_16Colors();
 				}
-				u16 tmp = m_16Color_currentFrameAddr;
-				m_16Color_currentFrameAddr = m_16Color_secondFrameAddr;
-				m_16Color_secondFrameAddr = tmp;
 			}
 
 			void Graphics::scroll_16Colors(void)
 			{
-				i32 line_len = (ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * 4);
-				for (i32 i = m_16Color_currentFrameAddr + line_len; i < m_16Color_currentFrameAddr + m_16Color_frameSize; i += 4)
+				u16 line_len = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * m_16Color_cellSize;
+				i8* frame = __frame_16Colors(m_16Color_currentFrameAddr);
+				std::memmove(frame, frame + line_len, m_16Color_frameSize - line_len);
+				//The new bottom line keeps the colors it had, only the characters are blanked
+				i8* last_line = frame + m_16Color_frameSize - line_len;
+				for (u16 i = 0; i < line_len; i += m_16Color_cellSize)
+					last_line[i + tText16_CellStructure::character] = 0x20;
+				m_16Color_framesDiverged = true;
+				m_16Color_allDirty = true;
+			}
+
+			bool Graphics::blitVRAM_16Colors(u16 x, u16 y, u8 width, u8 height, const u8* cells, u16 stride)
+			{
+				u8 clipped_w = width, clipped_h = height;
+				if (!__clip_rect_16Colors(x, y, clipped_w, clipped_h))
+					return false;
+				bool front = false;
+				i8* frame = __frame_16Colors(__target_frame_16Colors(front));
+				for (u8 row = 0; row < clipped_h; row++)
+				{
+					const u8* src = cells + (row * stride);
+					u16 first_cell = static_cast<u16>(CONVERT_2D_1D(x, y + row, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H));
+					i8* dest = frame + (first_cell * m_16Color_cellSize);
+					for (u8 col = 0; col < clipped_w; col++, src += tText16_CellStructure::MemorySizeBytes, dest += m_16Color_cellSize)
+					{
+						dest[tText16_CellStructure::character] = src[tText16_CellStructure::MemoryCharacter];
+						dest[tText16_CellStructure::foreground] = src[tText16_CellStructure::MemoryForeground];
+						dest[tText16_CellStructure::background] = src[tText16_CellStructure::MemoryBackground];
+						__mark_frame_diff_16Colors(first_cell + col);
+						if (front)
+							__mark_dirty_16Colors(first_cell + col);
+					}
+				}
+				return true;
+			}
+
+			bool Graphics::fillVRAM_16Colors(u16 x, u16 y, u8 width, u8 height, u8 character, u8 background, u8 foreground)
+			{
+				if (!__clip_rect_16Colors(x, y, width, height))
+					return false;
+				bool front = false;
+				i8* frame = __frame_16Colors(__target_frame_16Colors(front));
+				i8 cell_pattern[tText16_CellStructure::SizeBytes] { 0 };
+				cell_pattern[tText16_CellStructure::character] = character;
+				cell_pattern[tText16_CellStructure::foreground] = foreground;
+				cell_pattern[tText16_CellStructure::background] = background;
+				for (u8 row = 0; row < height; row++)
+				{
+					u16 first_cell = static_cast<u16>(CONVERT_2D_1D(x, y + row, ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H));
+					i8* dest = frame + (first_cell * m_16Color_cellSize);
+					std::memcpy(dest, cell_pattern, m_16Color_cellSize);
+					__replicate_cell_16Colors(dest, width * m_16Color_cellSize);
+					for (u8 col = 0; col < width; col++)
+					{
+						__mark_frame_diff_16Colors(first_cell + col);
+						if (front)
+							__mark_dirty_16Colors(first_cell + col);
+					}
+				}
+				return true;
+			}
+
+			bool Graphics::__clip_rect_16Colors(u16 x, u16 y, u8& inOutWidth, u8& inOutHeight)
+			{
+				const u16 screen_w = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H;
+				const u16 screen_h = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V;
+				if (x >= screen_w || y >= screen_h || inOutWidth == 0 || inOutHeight == 0)
+					return false;
+				inOutWidth = std::min<u16>(inOutWidth, screen_w - x);
+				inOutHeight = std::min<u16>(inOutHeight, screen_h - y);
+				return true;
+			}
+
+			u16 Graphics::__target_frame_16Colors(bool& outFrontBuffer)
+			{
+				outFrontBuffer = !readFlag(tFlags::DoubleBufferingEnabled);
+				return outFrontBuffer ? m_16Color_currentFrameAddr : m_16Color_secondFrameAddr;
+			}
+
+			void Graphics::clearDirtyCells_16Colors(void)
+			{
+				for (auto& cell : m_16Color_dirtyCells)
+					m_16Color_dirtyMap[cell] = false;
+				m_16Color_dirtyCells.clear();
+				m_16Color_allDirty = false;
+			}
+
+			void Graphics::__mark_dirty_16Colors(u16 cell)
+			{
+				if (m_16Color_allDirty || cell >= m_16Color_dirtyMap.size() || m_16Color_dirtyMap[cell]) return;
+				m_16Color_dirtyMap[cell] = true;
+				m_16Color_dirtyCells.push_back(cell);
+			}
+
+			bool Graphics::writePixel_Pixel16(u16 x, u16 y, u8 color)
+			{
+				if (x >= tPixel16::Width || y >= tPixel16::Height)
+					return false; //TODO: Error
+				i8* dest = __frame_16Colors(m_pixel16_frameAddr) + (y * tPixel16::LineSizeBytes) + (x / 2);
+				if (x % 2 == 0)
+					*dest = (i8)((*dest & 0x0F) | ((color & 0x0F) << 4));
+				else
+					*dest = (i8)((*dest & 0xF0) | (color & 0x0F));
+				__mark_dirty_line_Pixel16(y);
+				return true;
+			}
+
+			bool Graphics::blitPixels_Pixel16(u16 x, u16 y, u8 widthBytes, u8 height, const u8* packed, u16 stride)
+			{
+				//Blits copy whole bytes, so the destination starts at an even pixel
+				u16 column = x / 2;
+				if (column >= tPixel16::LineSizeBytes || y >= tPixel16::Height || widthBytes == 0 || height == 0)
+					return false;
+				u16 row_size = std::min<u16>(widthBytes, tPixel16::LineSizeBytes - column);
+				u16 rows = std::min<u16>(height, tPixel16::Height - y);
+				i8* frame = __frame_16Colors(m_pixel16_frameAddr);
+				for (u16 row = 0; row < rows; row++)
 				{
-					i32 k = i;
-					i8 outByte = 0;
-					m_videoMemory.r_Byte(k, outByte);
-					m_videoMemory.w_Byte(k - line_len, outByte);
-					k++;
-					m_videoMemory.r_Byte(k, outByte);
-					m_videoMemory.w_Byte(k - line_len, outByte);
-					k++;
-					m_videoMemory.r_Byte(k, outByte);
-					m_videoMemory.w_Byte(k - line_len, outByte);
+					std::memcpy(frame + ((y + row) * tPixel16::LineSizeBytes) + column, packed + (row * stride), row_size);
+					__mark_dirty_line_Pixel16(y + row);
 				}
-				for (i32 i = m_16Color_currentFrameAddr + m_16Color_frameSize - line_len; i < m_16Color_currentFrameAddr + m_16Color_frameSize; i += 4)
+				return true;
+			}
+
+			void Graphics::clearPixels_Pixel16(u8 color)
+			{
+				color &= 0x0F;
+				std::memset(__frame_16Colors(m_pixel16_frameAddr), (color << 4) | color, tPixel16::FrameSizeBytes);
+				m_pixel16_allDirty = true;
+			}
+
+			void Graphics::clearDirtyLines_Pixel16(void)
+			{
+				for (auto& line : m_pixel16_dirtyLines)
+					m_pixel16_dirtyMap[line] = false;
+				m_pixel16_dirtyLines.clear();
+				m_pixel16_allDirty = false;
+			}
+
+			void Graphics::__mark_dirty_line_Pixel16(u16 line)
+			{
+				if (m_pixel16_allDirty || line >= m_pixel16_dirtyMap.size() || m_pixel16_dirtyMap[line]) return;
+				m_pixel16_dirtyMap[line] = true;
+				m_pixel16_dirtyLines.push_back(line);
+			}
+
+			void Graphics::__mark_frame_diff_16Colors(u16 cell)
+			{
+				if (m_16Color_framesDiverged || cell >= m_16Color_frameDiffMap.size() || m_16Color_frameDiffMap[cell]) return;
+				m_16Color_frameDiffMap[cell] = true;
+				m_16Color_frameDiffCells.push_back(cell);
+			}
+
+			void Graphics::__clear_frame_diff_16Colors(void)
+			{
+				for (auto& cell : m_16Color_frameDiffCells)
+					m_16Color_frameDiffMap[cell] = false;
+				m_16Color_frameDiffCells.clear();
+				m_16Color_framesDiverged = false;
+			}
+
+			void Graphics::__replicate_cell_16Colors(i8* cells, u32 sizeBytes)
+			{
+				//The first cell is already in place: keep doubling the filled region so the copies stay large
+				u32 filled = m_16Color_cellSize;
+				while (filled < sizeBytes)
 				{
-					m_videoMemory.w_Byte(i, 0x20);
+					u32 chunk = std::min(filled, sizeBytes - filled);
+					std::memcpy(cells + filled, cells, chunk);
+					filled += chunk;
 				}
 			}
 
@@ -824,38 +1268,535 @@ namespace dragon
 
 
 
-			SerialPort::SerialPort(void)
+			SerialPort::SerialPort(MemoryMapper& memory, VirtualCPU& cpu) : m_memory(memory), m_cpu(cpu)
 			{
+				m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
 			}
 
 			i8 SerialPort::read8(u16 addr)
 			{
-				return 0x00;
+				__refresh_registers();
+				i8 value = 0;
+				if (!m_data.r_Byte(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Serial_ControllerReadFailed, "Failed to read byte from Serial Controller");
+					return 0;
+				}
+				return value;
 			}
 
 			i16 SerialPort::read16(u16 addr)
 			{
-				return 0x0000;
+				__refresh_registers();
+				i16 value = 0;
+				if (!m_data.r_Word(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Serial_ControllerReadFailed, "Failed to read word from Serial Controller");
+					return 0;
+				}
+				return value;
 			}
 
 			i8 SerialPort::write8(u16 addr, i8 value)
 			{
-				return 0x00;
+				if (__is_read_only(addr, 1))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Serial_ControllerWriteFailed, "Attempt to write byte to ReadOnly part of Serial Controller");
+					return 0;
+				}
+				if (!m_data.w_Byte(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Serial_ControllerWriteFailed, "Failed to write byte to Serial Controller");
+					return 0;
+				}
+				if (addr == tRegisters::TxData)
+					__transmit((u8)value);
+				else if (addr == tRegisters::Signal)
+					__handle_signal((u8)value);
+				return value;
 			}
 
 			i16 SerialPort::write16(u16 addr, i16 value)
 			{
-				return 0x0000;
+				if (__is_read_only(addr, 2))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Serial_ControllerWriteFailed, "Attempt to write word to ReadOnly part of Serial Controller");
+					return 0;
+				}
+				if (!m_data.w_Word(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Serial_ControllerWriteFailed, "Failed to write word to Serial Controller");
+					return 0;
+				}
+				for (u16 byteAddr = addr; byteAddr < addr + 2; byteAddr++)
+				{
+					u8 byte = 0;
+					m_data.r_Byte(byteAddr, (i8&)byte);
+					if (byteAddr == tRegisters::TxData)
+						__transmit(byte);
+					else if (byteAddr == tRegisters::Signal)
+						__handle_signal(byte);
+				}
+				return value;
 			}
 
 			ostd::ByteStream* SerialPort::getByteStream(void)
 			{
-				return nullptr;
+				__refresh_registers();
+				return &m_data.getData();
+			}
+
+			void SerialPort::cycleStep(void)
+			{
+				u8 control = 0;
+				m_data.r_Byte(tRegisters::Control, (i8&)control);
+				//One interrupt each time the receive ring goes from empty to non-empty, not one per byte
+				if (m_backend.getRxCount() == 0)
+					m_rxNotified = false;
+				else if (!m_rxNotified && (control & tControlValues::RxReadyInterrupt) != 0)
+				{
+					m_rxNotified = true;
+					m_cpu.handleInterrupt(data::InterruptCodes::SerialDataReceived, true);
+				}
+				if (m_txPending && m_backend.getTxCount() == 0)
+				{
+					m_txPending = false;
+					if ((control & tControlValues::TxEmptyInterrupt) != 0)
+						m_cpu.handleInterrupt(data::InterruptCodes::SerialTransmitEmpty, true);
+				}
 			}
 
+			void SerialPort::__handle_signal(u8 signal)
+			{
+				if (signal == tSignalValues::Ignore || signal == tSignalValues::None) return;
+				u16 address = 0, size = 0;
+				m_data.r_Word(tRegisters::DMAAddress, (i16&)address);
+				m_data.r_Word(tRegisters::DMASize, (i16&)size);
+				//Transfers stop at the end of the address space instead of wrapping around
+				u32 length = std::min((u32)size, 0x10000 - (u32)address);
+				u32 transferred = 0;
+				if (signal == tSignalValues::Send)
+				{
+					length = std::min(length, m_backend.getTxFree());
+					m_dmaBuffer.resize(length);
+					for (u32 i = 0; i < length; i++)
+						m_dmaBuffer[i] = (u8)m_memory.read8(address + i);
+					transferred = m_backend.write(m_dmaBuffer.data(), length);
+					m_txPending = m_txPending || transferred > 0;
+				}
+				else if (signal == tSignalValues::Receive)
+				{
+					m_dmaBuffer.resize(length);
+					transferred = m_backend.read(m_dmaBuffer.data(), length);
+					for (u32 i = 0; i < transferred; i++)
+						m_memory.write8(address + i, (i8)m_dmaBuffer[i]);
+				}
+				else if (signal == tSignalValues::PopByte)
+				{
+					u8 byte = 0;
+					transferred = m_backend.read(&byte, 1);
+				}
+				else if (signal == tSignalValues::FlushInput)
+					m_backend.flushInput();
+				m_data.w_Word(tRegisters::DMATransferred, (i16)transferred);
+				m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
+			}
+
+			void SerialPort::__transmit(u8 value)
+			{
+				//A full ring drops the byte, guests that care check Status.TxFull (or use DMA) first
+				if (m_backend.write(&value, 1) > 0)
+					m_txPending = true;
+			}
+
+			void SerialPort::__refresh_registers(void)
+			{
+				u8 rxByte = 0;
+				m_backend.peek(rxByte);
+				u32 rxCount = m_backend.getRxCount();
+				u32 txFree = m_backend.getTxFree();
+				u8 status = 0;
+				if (rxCount > 0) status |= tStatusValues::RxReady;
+				if (m_backend.getTxCount() == 0) status |= tStatusValues::TxEmpty;
+				if (txFree == 0) status |= tStatusValues::TxFull;
+				if (m_backend.isConnected()) status |= tStatusValues::Connected;
+				m_data.w_Byte(tRegisters::RxData, (i8)rxByte);
+				m_data.w_Byte(tRegisters::Status, (i8)status);
+				m_data.w_Word(tRegisters::RxCount, (i16)std::min(rxCount, (u32)0xFFFF));
+				m_data.w_Word(tRegisters::TxFree, (i16)std::min(txFree, (u32)0xFFFF));
+			}
+
+
 
 
 
+			HostCall::HostCall(MemoryMapper& memory) : m_memory(memory)
+			{
+				m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
+			}
+
+			i8 HostCall::read8(u16 addr)
+			{
+				i8 value = 0;
+				if (!m_data.r_Byte(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HostCall_ControllerReadFailed, "Failed to read byte from HostCall Controller");
+					return 0;
+				}
+				return value;
+			}
+
+			i16 HostCall::read16(u16 addr)
+			{
+				i16 value = 0;
+				if (!m_data.r_Word(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HostCall_ControllerReadFailed, "Failed to read word from HostCall Controller");
+					return 0;
+				}
+				return value;
+			}
+
+			i8 HostCall::write8(u16 addr, i8 value)
+			{
+				if (__is_read_only(addr, 1))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HostCall_ControllerWriteFailed, "Attempt to write byte to ReadOnly part of HostCall Controller");
+					return 0;
+				}
+				if (!m_data.w_Byte(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HostCall_ControllerWriteFailed, "Failed to write byte to HostCall Controller");
+					return 0;
+				}
+				if (addr == tRegisters::Signal)
+					__submit();
+				return value;
+			}
+
+			i16 HostCall::write16(u16 addr, i16 value)
+			{
+				if (__is_read_only(addr, 2))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HostCall_ControllerWriteFailed, "Attempt to write word to ReadOnly part of HostCall Controller");
+					return 0;
+				}
+				if (!m_data.w_Word(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::HostCall_ControllerWriteFailed, "Failed to write word to HostCall Controller");
+					return 0;
+				}
+				//Same per-byte dispatch as SerialPort, so it does not matter which half of the word is Signal
+				for (u16 byteAddr = addr; byteAddr < addr + 2; byteAddr++)
+				{
+					if (byteAddr == tRegisters::Signal)
+						__submit();
+				}
+				return value;
+			}
+
+			ostd::ByteStream* HostCall::getByteStream(void)
+			{
+				return &m_data.getData();
+			}
+
+			bool HostCall::mount(const String& rootDirectory, bool writable)
+			{
+				bool result = m_share.mount(rootDirectory, writable);
+				__refresh_registers();
+				return result;
+			}
+
+			void HostCall::__submit(void)
+			{
+				u8 signal = tSignalValues::Ignore;
+				m_data.r_Byte(tRegisters::Signal, (i8&)signal);
+				if (signal != tSignalValues::Submit) return;
+				u16 request = 0;
+				m_data.r_Word(tRegisters::RequestAddress, (i16&)request);
+				//Requests complete synchronously: the results are in the descriptor before the next instruction runs
+				m_data.w_Byte(tRegisters::Status, __execute(request));
+				m_data.w_Byte(tRegisters::Signal, tSignalValues::Ignore);
+				__refresh_registers();
+			}
+
+			u8 HostCall::__execute(u16 request)
+			{
+				u8 operation = m_memory.read8(request + tRequest::Operation);
+				u16 handle = m_memory.read16(request + tRequest::Handle);
+				u8 flags = m_memory.read8(request + tRequest::Flags);
+				u16 buffer = m_memory.read16(request + tRequest::BufferAddress);
+				u16 size = m_memory.read16(request + tRequest::Size);
+				u32 offset = ((u32)(u16)m_memory.read16(request + tRequest::Offset) << 16) | (u16)m_memory.read16(request + tRequest::Offset + 2);
+				//Transfers stop at the end of the address space instead of wrapping around
+				size = (u16)std::min((u32)size, 0x10000 - (u32)buffer);
+				u16 transferred = 0;
+				u8 status = HostShare::tStatusValues::Success;
+				String path = "";
+				if (!m_share.isMounted())
+					status = HostShare::tStatusValues::Disabled;
+				else if (operation == tOperations::Open)
+				{
+					if (!__read_path(m_memory.read16(request + tRequest::PathAddress), path))
+						status = HostShare::tStatusValues::InvalidPath;
+					else
+						status = m_share.openFile(path, flags, handle);
+					m_memory.write16(request + tRequest::Handle, handle);
+				}
+				else if (operation == tOperations::Read)
+				{
+					m_buffer.resize(size);
+					status = m_share.read(handle, offset, m_buffer.data(), size, transferred);
+					for (u16 i = 0; i < transferred; i++)
+						m_memory.write8(buffer + i, (i8)m_buffer[i]);
+				}
+				else if (operation == tOperations::Write)
+				{
+					m_buffer.resize(size);
+					for (u16 i = 0; i < size; i++)
+						m_buffer[i] = (u8)m_memory.read8(buffer + i);
+					status = m_share.write(handle, offset, m_buffer.data(), size, transferred);
+				}
+				else if (operation == tOperations::Stat)
+				{
+					u32 fileSize = 0;
+					u8 type = 0;
+					if (!__read_path(m_memory.read16(request + tRequest::PathAddress), path))
+						status = HostShare::tStatusValues::InvalidPath;
+					else
+						status = m_share.stat(path, fileSize, type);
+					m_memory.write8(request + tRequest::Flags, type);
+					m_memory.write16(request + tRequest::Offset, (i16)(fileSize >> 16));
+					m_memory.write16(request + tRequest::Offset + 2, (i16)(fileSize & 0xFFFF));
+				}
+				else if (operation == tOperations::Close)
+					status = m_share.closeFile(handle);
+				else
+					status = HostShare::tStatusValues::InvalidOperation;
+				m_memory.write16(request + tRequest::Transferred, transferred);
+				m_memory.write8(request + tRequest::Status, status);
+				return status;
+			}
+
+			bool HostCall::__read_path(u16 address, String& outPath)
+			{
+				outPath = "";
+				for (u16 i = 0; i <= HostShare::MaxPathLength; i++)
+				{
+					char c = (char)m_memory.read8(address + i);
+					if (c == 0)
+						return outPath != "";
+					outPath.addChar(c);
+				}
+				return false;
+			}
+
+			void HostCall::__refresh_registers(void)
+			{
+				u8 available = 0;
+				if (m_share.isMounted()) available |= tAvailableValues::Mounted;
+				if (m_share.isWritable()) available |= tAvailableValues::Writable;
+				m_data.w_Byte(tRegisters::Available, available);
+				m_data.w_Byte(tRegisters::OpenFiles, m_share.getOpenFileCount());
+			}
+
+			Timer::Timer(VirtualCPU& cpu, EventScheduler& scheduler) : m_cpu(cpu), m_scheduler(scheduler)
+			{
+				m_data.w_Byte(tRegisters::ChannelCount, ChannelCount);
+			}
+
+			i8 Timer::read8(u16 addr)
+			{
+				__refresh_registers();
+				i8 value = 0;
+				if (!m_data.r_Byte(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Timer_ControllerReadFailed, "Failed to read byte from Timer Controller");
+					return 0;
+				}
+				return value;
+			}
+
+			i16 Timer::read16(u16 addr)
+			{
+				__refresh_registers();
+				i16 value = 0;
+				if (!m_data.r_Word(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Timer_ControllerReadFailed, "Failed to read word from Timer Controller");
+					return 0;
+				}
+				return value;
+			}
+
+			i8 Timer::write8(u16 addr, i8 value)
+			{
+				if (__is_read_only(addr, 1))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Timer_ControllerWriteFailed, "Attempt to write byte to ReadOnly part of Timer Controller");
+					return 0;
+				}
+				u8 fired = 0;
+				m_data.r_Byte(tRegisters::Fired, (i8&)fired);
+				if (!m_data.w_Byte(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Timer_ControllerWriteFailed, "Failed to write byte to Timer Controller");
+					return 0;
+				}
+				__after_write(addr, 1, fired);
+				return value;
+			}
+
+			i16 Timer::write16(u16 addr, i16 value)
+			{
+				if (__is_read_only(addr, 2))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Timer_ControllerWriteFailed, "Attempt to write word to ReadOnly part of Timer Controller");
+					return 0;
+				}
+				u8 fired = 0;
+				m_data.r_Byte(tRegisters::Fired, (i8&)fired);
+				if (!m_data.w_Word(addr, value))
+				{
+					data::ErrorHandler::pushError(data::ErrorCodes::Timer_ControllerWriteFailed, "Failed to write word to Timer Controller");
+					return 0;
+				}
+				__after_write(addr, 2, fired);
+				return value;
+			}
+
+			ostd::ByteStream* Timer::getByteStream(void)
+			{
+				__refresh_registers();
+				return &m_data.getData();
+			}
+
+			void Timer::cycleStep(void)
+			{
+				//Expiring channels are run by the EventScheduler, only the delivery of their interrupts is left here.
+				//Unlike the other devices the timer waits for InterruptsEnabled, so a periodic tick can't land inside a critical section;
+				// one pending channel is delivered per cycle to avoid stacking several handlers at once
+				if (m_pendingInterrupts == 0 || !m_cpu.readFlag(data::Flags::InterruptsEnabled))
+					return;
+				for (u8 i = 0; i < ChannelCount; i++)
+				{
+					if ((m_pendingInterrupts & (1 << i)) == 0) continue;
+					m_pendingInterrupts &= ~(1 << i);
+					m_cpu.handleInterrupt(data::InterruptCodes::TimerChannel0 + i, true);
+					break;
+				}
+			}
+
+			void Timer::__arm(u8 channel, u8 mode)
+			{
+				u16 base = tRegisters::Channels + (channel * tChannel::SizeBytes);
+				u16 reloadHigh = 0, reloadLow = 0;
+				m_data.r_Word(base + tChannel::Reload, (i16&)reloadHigh);
+				m_data.r_Word(base + tChannel::Reload + 2, (i16&)reloadLow);
+				u32 reload = ((u32)reloadHigh << 16) | reloadLow;
+				tChannelState& state = m_channels[channel];
+				m_scheduler.cancel(state.event);
+				state.event = EventScheduler::InvalidEvent;
+				if ((mode != tModeValues::OneShot && mode != tModeValues::Periodic) || reload == 0)
+				{
+					state.mode = tModeValues::Disabled;
+					m_data.w_Byte(base + tChannel::Mode, tModeValues::Disabled);
+				}
+				else
+				{
+					state.mode = mode;
+					state.reload = reload;
+					state.deadline = m_cpu.getCycleCount() + reload;
+					__schedule(channel);
+				}
+				m_pendingInterrupts &= ~(1 << channel);
+			}
+
+			void Timer::__fire(u8 channel)
+			{
+				u16 base = tRegisters::Channels + (channel * tChannel::SizeBytes);
+				tChannelState& state = m_channels[channel];
+				state.event = EventScheduler::InvalidEvent;
+				u8 fired = 0, interrupt = tInterruptValues::Disabled;
+				m_data.r_Byte(tRegisters::Fired, (i8&)fired);
+				m_data.w_Byte(tRegisters::Fired, fired | (1 << channel));
+				m_data.r_Byte(base + tChannel::Interrupt, (i8&)interrupt);
+				if (interrupt == tInterruptValues::Enabled)
+					m_pendingInterrupts |= (1 << channel);
+				if (state.mode == tModeValues::OneShot)
+				{
+					state.mode = tModeValues::Disabled;
+					m_data.w_Byte(base + tChannel::Mode, tModeValues::Disabled);
+					return;
+				}
+				//Periodic: a new Reload value takes effect from the next period
+				u16 reloadHigh = 0, reloadLow = 0;
+				m_data.r_Word(base + tChannel::Reload, (i16&)reloadHigh);
+				m_data.r_Word(base + tChannel::Reload + 2, (i16&)reloadLow);
+				u32 reload = ((u32)reloadHigh << 16) | reloadLow;
+				if (reload != 0)
+					state.reload = reload;
+				state.deadline += state.reload;
+				//Missed periods (ex. a debugger pause) are dropped instead of firing in a burst
+				if (state.deadline <= m_cpu.getCycleCount())
+					state.deadline = m_cpu.getCycleCount() + state.reload;
+				__schedule(channel);
+			}
+
+			void Timer::__schedule(u8 channel)
+			{
+				m_channels[channel].event = m_scheduler.schedule(m_channels[channel].deadline, [this, channel]() { __fire(channel); });
+			}
+
+			void Timer::__refresh_registers(void)
+			{
+				u64 now = m_cpu.getCycleCount();
+				m_data.w_Word(tRegisters::Cycles, (i16)(now >> 48));
+				m_data.w_Word(tRegisters::Cycles + 2, (i16)(now >> 32));
+				m_data.w_Word(tRegisters::Cycles + 4, (i16)(now >> 16));
+				m_data.w_Word(tRegisters::Cycles + 6, (i16)now);
+				for (u8 i = 0; i < ChannelCount; i++)
+				{
+					u16 base = tRegisters::Channels + (i * tChannel::SizeBytes);
+					u32 remaining = 0;
+					if (m_channels[i].mode != tModeValues::Disabled && m_channels[i].deadline > now)
+						remaining = (u32)std::min(m_channels[i].deadline - now, (u64)0xFFFFFFFF);
+					m_data.w_Word(base + tChannel::Remaining, (i16)(remaining >> 16));
+					m_data.w_Word(base + tChannel::Remaining + 2, (i16)remaining);
+				}
+			}
+
+			void Timer::__after_write(u16 addr, u8 size, u8 firedBefore)
+			{
+				for (u16 byteAddr = addr; byteAddr < addr + size; byteAddr++)
+				{
+					u8 value = 0;
+					m_data.r_Byte(byteAddr, (i8&)value);
+					//Fired is write-1-to-clear
+					if (byteAddr == tRegisters::Fired)
+						m_data.w_Byte(tRegisters::Fired, firedBefore & ~value);
+					else if (byteAddr >= tRegisters::Channels && byteAddr < tRegisters::Channels + (ChannelCount * tChannel::SizeBytes))
+					{
+						u8 channel = (byteAddr - tRegisters::Channels) / tChannel::SizeBytes;
+						if ((byteAddr - tRegisters::Channels) % tChannel::SizeBytes == tChannel::Mode)
+							__arm(channel, value);
+					}
+				}
+			}
+
+			bool Timer::__is_read_only(u16 addr, u8 size) const
+			{
+				for (u16 byteAddr = addr; byteAddr < addr + size; byteAddr++)
+				{
+					if (byteAddr < tRegisters::Cycles + 8 || byteAddr == tRegisters::ChannelCount)
+						return true;
+					if (byteAddr < tRegisters::Channels) continue;
+					u16 offset = (byteAddr - tRegisters::Channels) % tChannel::SizeBytes;
+					if (offset >= tChannel::Remaining && offset < tChannel::Remaining + 4)
+						return true;
+				}
+				return false;
+			}
 
 			void CMOS::init(const String& cmosFilePath)
 			{
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "IMemoryDevice.hpp"
+#include "DiskIOEngine.hpp"
+#include "DiskTrace.hpp"
+#include "SerialBackend.hpp"
+#include "HostShare.hpp"
+#include "EventScheduler.hpp"
 #include "../tools/GlobalData.hpp"
 #include "../tools/LegacyOstdSerial.hpp"
 #include <fstream>
 #include <unordered_map>
+#include <chrono>
+#include <deque>
 
 namespace dragon
 {
@@ -221,6 +228,30 @@ namespace dragon
 			{
 				inline static constexpr u16 Modifiers = 0x00;
 				inline static constexpr u16 KeyCode = 0x02;
+
+				//Event queue: the guest may write these two registers outside of BIOS mode
+				inline static constexpr u16 QueueControl = 0x04;
+				inline static constexpr u16 QueueHead = 0x05;
+
+				inline static constexpr u16 QueueTail = 0x06;
+				inline static constexpr u16 QueueSize = 0x07;
+				inline static constexpr u16 QueueDropped = 0x08;
+
+				inline static constexpr u16 QueueEvents = 0x20;
+			};
+			public: struct tQueueControlValues
+			{
+				inline static constexpr u8 Disabled = 0x00;
+				inline static constexpr u8 Enabled = 0x01;
+			};
+			public: struct tQueueEvent
+			{
+				inline static constexpr u16 Type = 0x00;
+				inline static constexpr u16 Modifiers = 0x02;
+				inline static constexpr u16 KeyCode = 0x04;
+
+				inline static constexpr u16 SizeBytes = 6;
+				inline static constexpr u8 QueueLength = 32;
 			};
 
 			public:
@@ -234,6 +265,11 @@ namespace dragon
 				ostd::ByteStream* getByteStream(void) override;
 
 				void handleSignal(ostd::Signal& signal) override;
+				void processPendingEvents(void);
+				//True while legacy-mode events are still waiting to be delivered one by one
+				inline bool hasUndeliveredEvents(void) const { return !m_processedEvents.empty(); }
+				//Queues a key event coming from a host input source other than the window (e.g. the terminal backend)
+				void queueKeyEvent(i16 keyCode, u16 modifiers, u8 interrupt);
 
 			private:
 				ostd::BitField_16 __construct_modifiers_bitfield(void);
@@ -241,9 +277,27 @@ namespace dragon
 				i16 __write16(u16 addr, i16 value);
 				i16 __sdl_key_code_convert(i32 keyCode);
 
+			private:
+				//Key events arrive on the window thread and are applied by the emulation thread
+				struct tPendingEvent
+				{
+					u16 modifiers { 0 };
+					i16 keyCode { 0 };
+					u8 interrupt { 0 };
+					bool raiseInterrupt { false };
+				};
+
+				void __queue_push(const tPendingEvent& event);
+
 			private:
 				ostd::ByteStream m_data;
 				ostd::BitField_16 m_modifiersBitFiels;
+				std::mutex m_pendingEventsMutex;
+				std::vector<tPendingEvent> m_pendingEvents;
+				std::deque<tPendingEvent> m_processedEvents;
+				std::atomic<bool> m_hasPendingEvents { false };
+				i32 m_legacyHandlerDepth { 0 };
+				bool m_legacyEventInFlight { false };
 		};
 		class VirtualMouse : public IMemoryDevice
 		{
@@ -296,6 +350,20 @@ namespace dragon
 					inline static constexpr u16 RestDataSize = 0x11;
 					inline static constexpr u16 SourceData = 0x13;
 
+					inline static constexpr u16 LastReadOnly = 0x1F;
+
+					inline static constexpr u16 QueueControl = 0x20;
+					inline static constexpr u16 QueueSize = 0x21;
+					inline static constexpr u16 QueueSubmissionBase = 0x22;
+					inline static constexpr u16 QueueCompletionBase = 0x24;
+					inline static constexpr u16 QueueDoorbell = 0x26;
+					inline static constexpr u16 QueueCompletionHead = 0x27;
+
+					inline static constexpr u16 FirstQueueReadOnly = 0x30;
+
+					inline static constexpr u16 QueueSubmissionHead = 0x30;
+					inline static constexpr u16 QueueCompletionTail = 0x31;
+					inline static constexpr u16 QueueInFlight = 0x32;
 				};
 
 				public: struct tSignalValues
@@ -319,6 +387,44 @@ namespace dragon
 					inline static constexpr u8 Reading = 0x02;
 				};
 
+				public: struct tQueueControlValues
+				{
+					inline static constexpr u8 Disabled = 0x00;
+					inline static constexpr u8 Enabled = 0x01;
+				};
+
+				public: struct tQueueDescriptor
+				{
+					inline static constexpr u16 Tag = 0x00;
+					inline static constexpr u16 Mode = 0x02;
+					inline static constexpr u16 Disk = 0x03;
+					inline static constexpr u16 Sector = 0x04;
+					inline static constexpr u16 Address = 0x06;
+					inline static constexpr u16 DataSize = 0x08;
+					inline static constexpr u16 MemoryAddress = 0x0A;
+
+					inline static constexpr u16 SizeBytes = 12;
+				};
+
+				public: struct tQueueCompletion
+				{
+					inline static constexpr u16 Tag = 0x00;
+					inline static constexpr u16 Status = 0x02;
+					inline static constexpr u16 Phase = 0x03;
+
+					inline static constexpr u16 SizeBytes = 4;
+				};
+
+				public: struct tQueueStatusValues
+				{
+					inline static constexpr u8 Success = 0x00;
+					inline static constexpr u8 InvalidDisk = 0x01;
+					inline static constexpr u8 EndOfDisk = 0x02;
+					inline static constexpr u8 MemoryOverflow = 0x03;
+					inline static constexpr u8 IOError = 0x04;
+					inline static constexpr u8 InvalidMode = 0x05;
+				};
+
 				public:
 					Disk(MemoryMapper& memory, VirtualCPU& cpu);
 					i8 read8(u16 addr) override;
@@ -332,11 +438,54 @@ namespace dragon
 					bool connectDisk(VirtualHardDrive& hdd, data::VDiskID disk_id);
 					bool disconnectDisk(data::VDiskID diskID);
 
-					inline bool isBusy(void) const { return m_busy; }
+					inline bool isBusy(void) const { return m_busy || m_queuedCommands.size() > 0; }
+					inline void startIOEngine(u8 workerCount) { m_ioEngine.start(workerCount); }
+					inline void stopIOEngine(void) { m_ioEngine.stop(); }
+
+					inline bool startTrace(const String& filePath) { return m_trace.open(filePath); }
+					inline void stopTrace(void) { m_trace.close(); }
+					inline const std::unordered_map<data::VDiskID, DiskIOStats>& getStats(void) const { return m_stats; }
+
+				private: struct tQueuedCommand
+				{
+					u16 tag { 0 };
+					u16 memoryAddress { 0 };
+				};
+				private: struct tRequestTiming
+				{
+					u8 disk { 0 };
+					u8 source { DiskTraceFile::tSourceValues::Registers };
+					u64 startCycle { 0 };
+					std::chrono::steady_clock::time_point startTime;
+				};
+
+				private:
+					u8 __build_request(u8 mode, u8 disk, u16 sector, u16 address, u16 size, u16 memoryAddress, DiskIOEngine::tRequest& outRequest);
+					void __start_transfer(void);
+					void __finish_transfer(DiskIOEngine::tRequest& request);
+					void __submit_queued_commands(void);
+					void __poll_completions(void);
+					void __post_completion(u16 tag, u8 status);
+					u32 __submit(DiskIOEngine::tRequest& request, u8 disk, u8 source);
+					void __record_completion(const DiskIOEngine::tRequest& request);
+					inline bool __is_read_only(u16 addr, u8 size) const
+					{
+						u16 last = addr + size - 1;
+						return (last >= tRegisters::FirstReadOnly && addr <= tRegisters::LastReadOnly) || last >= tRegisters::FirstQueueReadOnly;
+					}
 
 				private:
 					ostd::serial::SerialIO m_data { data::MemoryMapAddresses::DiskInterface_End - data::MemoryMapAddresses::DiskInterface_Start };
 					bool m_busy { false };
+					DiskIOEngine m_ioEngine;
+					u32 m_activeRequest { 0 };
+					std::unordered_map<u32, tQueuedCommand> m_queuedCommands;
+					bool m_queueEnabled { false };
+					bool m_queueCompletionsPosted { false };
+					u8 m_completionPhase { 1 };
+					std::unordered_map<u32, tRequestTiming> m_requestTimings;
+					std::unordered_map<data::VDiskID, DiskIOStats> m_stats;
+					DiskTraceFile m_trace;
 					std::unordered_map<data::VDiskID, VirtualHardDrive*> m_connectedDisks;
 					MemoryMapper& m_memory;
 					VirtualCPU& m_cpu;
@@ -358,11 +507,27 @@ namespace dragon
 					inline static constexpr u8 foreground	=			0x01;
 					inline static constexpr u8 background	=			0x02;
 					inline static constexpr u8 reserved	=			0x03;
+					inline static constexpr u8 SizeBytes	=			0x04;
+
+					//Layout of a cell in guest memory for bulk blits (character, foreground, background)
+					inline static constexpr u8 MemoryCharacter	=	0x00;
+					inline static constexpr u8 MemoryForeground	=	0x01;
+					inline static constexpr u8 MemoryBackground	=	0x02;
+					inline static constexpr u8 MemorySizeBytes	=	0x03;
+				};
+				public: struct tPixel16
+				{
+					//Packed 4 bits per pixel (left pixel in the high nibble), indexed through the 16 color palette
+					inline static constexpr u16 Width			=		320;
+					inline static constexpr u16 Height			=		240;
+					inline static constexpr u16 LineSizeBytes	=		Width / 2;
+					inline static constexpr u16 FrameSizeBytes	=		LineSizeBytes * Height;
 				};
 				public: struct tFlags
 				{
 					inline static constexpr u8 DoubleBufferingEnabled 	=		0;
 					inline static constexpr u8 ScreenRedrawDisabled 	=		1;
+					inline static constexpr u8 SwapCopiesFrontBuffer 	=		2;
 				};
 				public:
 					Graphics(void);
@@ -382,23 +547,184 @@ namespace dragon
 					bool clearVRAM_16Colors(u8 character = 0, u8 background = 0x00, u8 foreground = 0xFF);
 					void swapBuffers_16Colors(void);
 					void scroll_16Colors(void);
+					bool blitVRAM_16Colors(u16 x, u16 y, u8 width, u8 height, const u8* cells, u16 stride);
+					bool fillVRAM_16Colors(u16 x, u16 y, u8 width, u8 height, u8 character = 0, u8 background = 0x00, u8 foreground = 0xFF);
+
+					inline bool isFullyDirty_16Colors(void) const { return m_16Color_allDirty; }
+					inline const std::vector<u16>& getDirtyCells_16Colors(void) const { return m_16Color_dirtyCells; }
+					inline void markAllDirty_16Colors(void) { m_16Color_allDirty = true; }
+					void clearDirtyCells_16Colors(void);
+
+					bool writePixel_Pixel16(u16 x, u16 y, u8 color);
+					bool blitPixels_Pixel16(u16 x, u16 y, u8 widthBytes, u8 height, const u8* packed, u16 stride);
+					void clearPixels_Pixel16(u8 color);
+					inline const u8* getFrame_Pixel16(void) { return (const u8*)__frame_16Colors(m_pixel16_frameAddr); }
+					inline bool isFullyDirty_Pixel16(void) const { return m_pixel16_allDirty; }
+					inline const std::vector<u16>& getDirtyLines_Pixel16(void) const { return m_pixel16_dirtyLines; }
+					inline void markAllDirty_Pixel16(void) { m_pixel16_allDirty = true; }
+					void clearDirtyLines_Pixel16(void);
+
+				private:
+					void __mark_dirty_16Colors(u16 cell);
+					bool __clip_rect_16Colors(u16 x, u16 y, u8& inOutWidth, u8& inOutHeight);
+					u16 __target_frame_16Colors(bool& outFrontBuffer);
+					void __mark_frame_diff_16Colors(u16 cell);
+					void __clear_frame_diff_16Colors(void);
+					void __replicate_cell_16Colors(i8* cells, u32 sizeBytes);
+					inline i8* __frame_16Colors(u16 frameAddr) { return m_videoMemory.getData().data() + frameAddr; }
+					void __mark_dirty_line_Pixel16(u16 line);
 
 				private:
 					ostd::serial::SerialIO m_videoMemory;
 
 					u16 m_vramStart { 0 };
-					u8 m_16Color_cellSize { 4 };
+					u8 m_16Color_cellSize { tText16_CellStructure::SizeBytes };
 					u16 m_16Color_frameSize { 0 };
 					u16 m_16Color_secondFrameAddr { 0 };
 					u16 m_16Color_currentFrameAddr { 0 };
 					bool m_16Color_doubleBufferingEnabled { false };
+					std::vector<u16> m_16Color_dirtyCells;
+					std::vector<bool> m_16Color_dirtyMap;
+					bool m_16Color_allDirty { true };
+					std::vector<u16> m_16Color_frameDiffCells;
+					std::vector<bool> m_16Color_frameDiffMap;
+					bool m_16Color_framesDiverged { true };
+
+					u16 m_pixel16_frameAddr { 0 };
+					std::vector<u16> m_pixel16_dirtyLines;
+					std::vector<bool> m_pixel16_dirtyMap;
+					bool m_pixel16_allDirty { true };
 
 					ostd::BitField_16 m_tempFlags;
 			};
 			class SerialPort : public IMemoryDevice
 			{
+				public: struct tRegisters
+				{
+					inline static constexpr u16 Control = 0x00;
+					inline static constexpr u16 Signal = 0x01;
+					inline static constexpr u16 TxData = 0x02;
+					inline static constexpr u16 DMAAddress = 0x03;
+					inline static constexpr u16 DMASize = 0x05;
+
+					inline static constexpr u16 FirstReadOnly = 0x07;
+
+					inline static constexpr u16 RxData = 0x07;
+					inline static constexpr u16 Status = 0x08;
+					inline static constexpr u16 RxCount = 0x09;
+					inline static constexpr u16 TxFree = 0x0B;
+					inline static constexpr u16 DMATransferred = 0x0D;
+				};
+
+				public: struct tControlValues
+				{
+					inline static constexpr u8 RxReadyInterrupt = 0x01;
+					inline static constexpr u8 TxEmptyInterrupt = 0x02;
+				};
+
+				public: struct tSignalValues
+				{
+					//Signal is the low byte of a word written at Control, so 0x00 must not start anything
+					inline static constexpr u8 None = 0x00;
+					inline static constexpr u8 Send = 0x01;
+					inline static constexpr u8 Receive = 0x02;
+					inline static constexpr u8 PopByte = 0x03;
+					inline static constexpr u8 FlushInput = 0x04;
+
+					inline static constexpr u8 Ignore = 0xFF;
+				};
+
+				public: struct tStatusValues
+				{
+					inline static constexpr u8 RxReady = 0x01;
+					inline static constexpr u8 TxEmpty = 0x02;
+					inline static constexpr u8 TxFull = 0x04;
+					inline static constexpr u8 Connected = 0x08;
+				};
+
+				public:
+					SerialPort(MemoryMapper& memory, VirtualCPU& cpu);
+					i8 read8(u16 addr) override;
+					i16 read16(u16 addr) override;
+					i8 write8(u16 addr, i8 value) override;
+					i16 write16(u16 addr, i16 value) override;
+
+					ostd::ByteStream* getByteStream(void) override;
+
+					void cycleStep(void);
+					inline bool connect(const String& spec, String& outError) { return m_backend.start(spec, outError); }
+					inline void disconnect(void) { m_backend.stop(); }
+					inline const SerialBackend& getBackend(void) const { return m_backend; }
+
+				private:
+					void __handle_signal(u8 signal);
+					void __transmit(u8 value);
+					void __refresh_registers(void);
+					inline bool __is_read_only(u16 addr, u8 size) const { return addr + size - 1 >= tRegisters::FirstReadOnly; }
+
+				private:
+					ostd::serial::SerialIO m_data { data::MemoryMapAddresses::SerialInterface_End - data::MemoryMapAddresses::SerialInterface_Start };
+					MemoryMapper& m_memory;
+					VirtualCPU& m_cpu;
+					SerialBackend m_backend;
+					std::vector<u8> m_dmaBuffer;
+					bool m_rxNotified { false };
+					bool m_txPending { false };
+			};
+			class HostCall : public IMemoryDevice
+			{
+				public: struct tRegisters
+				{
+					inline static constexpr u16 RequestAddress = 0x00;
+					inline static constexpr u16 Signal = 0x02;
+
+					inline static constexpr u16 FirstReadOnly = 0x03;
+
+					inline static constexpr u16 Status = 0x03;
+					inline static constexpr u16 Available = 0x04;
+					inline static constexpr u16 OpenFiles = 0x05;
+				};
+
+				public: struct tSignalValues
+				{
+					inline static constexpr u8 Submit = 0x00;
+
+					inline static constexpr u8 Ignore = 0xFF;
+				};
+
+				public: struct tAvailableValues
+				{
+					inline static constexpr u8 Mounted = 0x01;
+					inline static constexpr u8 Writable = 0x02;
+				};
+
+				public: struct tOperations
+				{
+					inline static constexpr u8 Open = 0x00;
+					inline static constexpr u8 Read = 0x01;
+					inline static constexpr u8 Write = 0x02;
+					inline static constexpr u8 Stat = 0x03;
+					inline static constexpr u8 Close = 0x04;
+				};
+
+				//Request descriptor, in guest memory
+				public: struct tRequest
+				{
+					inline static constexpr u16 Operation = 0x00;
+					inline static constexpr u16 Status = 0x01;
+					inline static constexpr u16 Handle = 0x02;
+					inline static constexpr u16 Flags = 0x04;
+					inline static constexpr u16 PathAddress = 0x06;
+					inline static constexpr u16 BufferAddress = 0x08;
+					inline static constexpr u16 Size = 0x0A;
+					inline static constexpr u16 Offset = 0x0C;
+					inline static constexpr u16 Transferred = 0x10;
+
+					inline static constexpr u16 SizeBytes = 18;
+				};
+
 				public:
-					SerialPort(void);
+					HostCall(MemoryMapper& memory);
 					i8 read8(u16 addr) override;
 					i16 read16(u16 addr) override;
 					i8 write8(u16 addr, i8 value) override;
@@ -406,7 +732,94 @@ namespace dragon
 
 					ostd::ByteStream* getByteStream(void) override;
 
+					bool mount(const String& rootDirectory, bool writable);
+					inline void unmount(void) { m_share.unmount(); __refresh_registers(); }
+					inline const HostShare& getShare(void) const { return m_share; }
+
+				private:
+					void __submit(void);
+					u8 __execute(u16 request);
+					bool __read_path(u16 address, String& outPath);
+					void __refresh_registers(void);
+					inline bool __is_read_only(u16 addr, u8 size) const { return addr + size - 1 >= tRegisters::FirstReadOnly; }
+
 				private:
+					ostd::serial::SerialIO m_data { data::MemoryMapAddresses::HostCall_End - data::MemoryMapAddresses::HostCall_Start };
+					MemoryMapper& m_memory;
+					HostShare m_share;
+					std::vector<u8> m_buffer;
+			};
+			class Timer : public IMemoryDevice
+			{
+				public: struct tRegisters
+				{
+					inline static constexpr u16 Cycles = 0x00;
+					inline static constexpr u16 Fired = 0x08;
+					inline static constexpr u16 ChannelCount = 0x09;
+
+					inline static constexpr u16 Channels = 0x10;
+				};
+
+				//Registers of each channel, relative to Channels + (channel * tChannel::SizeBytes)
+				public: struct tChannel
+				{
+					inline static constexpr u16 Mode = 0x00;
+					inline static constexpr u16 Interrupt = 0x01;
+					inline static constexpr u16 Reload = 0x02;
+					inline static constexpr u16 Remaining = 0x06;
+
+					inline static constexpr u16 SizeBytes = 12;
+				};
+
+				public: struct tModeValues
+				{
+					inline static constexpr u8 Disabled = 0x00;
+					inline static constexpr u8 OneShot = 0x01;
+					inline static constexpr u8 Periodic = 0x02;
+				};
+
+				public: struct tInterruptValues
+				{
+					inline static constexpr u8 Disabled = 0x00;
+					inline static constexpr u8 Enabled = 0x01;
+				};
+
+				public:
+					inline static constexpr u8 ChannelCount = 4;
+
+				public:
+					Timer(VirtualCPU& cpu, EventScheduler& scheduler);
+					i8 read8(u16 addr) override;
+					i16 read16(u16 addr) override;
+					i8 write8(u16 addr, i8 value) override;
+					i16 write16(u16 addr, i16 value) override;
+
+					ostd::ByteStream* getByteStream(void) override;
+
+					void cycleStep(void);
+
+				private: struct tChannelState
+				{
+					u8 mode { tModeValues::Disabled };
+					u32 reload { 0 };
+					u64 deadline { 0 };
+					u64 event { EventScheduler::InvalidEvent };
+				};
+
+				private:
+					void __arm(u8 channel, u8 mode);
+					void __fire(u8 channel);
+					void __schedule(u8 channel);
+					void __refresh_registers(void);
+					void __after_write(u16 addr, u8 size, u8 firedBefore);
+					bool __is_read_only(u16 addr, u8 size) const;
+
+				private:
+					ostd::serial::SerialIO m_data { data::MemoryMapAddresses::Timer_End - data::MemoryMapAddresses::Timer_Start };
+					VirtualCPU& m_cpu;
+					EventScheduler& m_scheduler;
+					tChannelState m_channels[ChannelCount];
+					u8 m_pendingInterrupts { 0 };
 			};
 			class CMOS : public IMemoryDevice
 			{
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <condition_variable>
+#include <chrono>
+#include <mutex>
+
+namespace dragon
+{
+	namespace hw
+	{
+		//Lets the emulation thread sleep while the vCPU waits for an interrupt (wfi):
+		// every source of hardware interrupts that lives on another thread calls notify() when it has something new
+		class WakeupSignal
+		{
+			public:
+				inline static void notify(void)
+				{
+					{
+						std::lock_guard<std::mutex> lock(m_lock);
+						m_pending = true;
+					}
+					m_signal.notify_one();
+				}
+
+				//Returns as soon as notify() is called, or immediately if it was called since the last wait
+				inline static void wait(f64 timeoutSeconds)
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_signal.wait_for(lock, std::chrono::duration<f64>(timeoutSeconds), []() { return m_pending; });
+					m_pending = false;
+				}
+
+			private:
+				inline static std::mutex m_lock;
+				inline static std::condition_variable m_signal;
+				inline static bool m_pending { false };
+		};
+	}
+}
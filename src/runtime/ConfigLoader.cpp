@@ -115,6 +115,135 @@ namespace dragon
 				if (!lineEdit.isNumeric()) continue; //TODO: Error
 				config.screen_redraw_rate_per_second = lineEdit.toInt();
 			}
+			else if (lineEdit == "disk_io_threads")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (!lineEdit.isNumeric()) continue; //TODO: Error
+				i64 ioThreads = lineEdit.toInt();
+				if (ioThreads < 0 || ioThreads > 0xFF) continue; //TODO: Error
+				config.disk_io_threads = (u8)ioThreads;
+			}
+			else if (lineEdit == "disk_cache_size_mib")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (!lineEdit.isNumeric()) continue; //TODO: Error
+				config.disk_cache.capacityMiB = lineEdit.toInt();
+			}
+			else if (lineEdit == "disk_cache_block_size")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (!lineEdit.isNumeric()) continue; //TODO: Error
+				config.disk_cache.blockSize = lineEdit.toInt();
+			}
+			else if (lineEdit == "disk_cache_read_ahead")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (!lineEdit.isNumeric()) continue; //TODO: Error
+				i64 readAhead = lineEdit.toInt();
+				if (readAhead < 0 || readAhead > 0xFF) continue; //TODO: Error
+				config.disk_cache.readAheadBlocks = (u8)readAhead;
+			}
+			else if (lineEdit == "disk_cache_policy")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (lineEdit == "write_back")
+					config.disk_cache.writePolicy = hw::DiskBlockCache::eWritePolicy::WriteBack;
+				else if (lineEdit == "write_through")
+					config.disk_cache.writePolicy = hw::DiskBlockCache::eWritePolicy::WriteThrough;
+				else continue; //TODO: Error
+			}
+			else if (lineEdit == "disk_trace_file")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				config.disk_trace_file = lineEdit;
+			}
+			else if (lineEdit == "disk_stats")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (lineEdit == "true")
+					config.disk_stats = true;
+				else if (lineEdit == "false")
+					config.disk_stats = false;
+				else continue; //TODO: Error
+			}
+			else if (lineEdit == "text_scrollback_lines")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (!lineEdit.isNumeric()) continue; //TODO: Error
+				i64 lines = lineEdit.toInt();
+
+				//TODO: Warnings
+				if (lines < 0)
+					lines = 0;
+				if (lines > data::DefaultValues::MaxTextScrollbackLines)
+					lines = data::DefaultValues::MaxTextScrollbackLines;
+				config.text_scrollback_lines = (u32)lines;
+			}
+			else if (lineEdit == "text_scrollback_file")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				config.text_scrollback_file = lineEdit;
+			}
+			else if (lineEdit == "display_backend")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (lineEdit == "window")
+					config.terminal_display = false;
+				else if (lineEdit == "terminal")
+					config.terminal_display = true;
+				else continue; //TODO: Error
+			}
+			else if (lineEdit == "framebuffer_shm")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				config.framebuffer_shm = lineEdit;
+			}
+			else if (lineEdit == "input_script")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				config.input_script = lineEdit;
+			}
+			else if (lineEdit == "input_script_report")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				config.input_script_report = lineEdit;
+			}
+			else if (lineEdit == "serial")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				if (lineEdit.new_toLower() == "none") continue;
+				config.serial_backend = lineEdit;
+			}
+			else if (lineEdit == "host_share")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim();
+				config.host_share = lineEdit;
+			}
+			else if (lineEdit == "host_share_writable")
+			{
+				lineEdit = tokens.next();
+				lineEdit.trim().toLower();
+				if (lineEdit == "true")
+					config.host_share_writable = true;
+				else if (lineEdit == "false")
+					config.host_share_writable = false;
+				else continue; //TODO: Error
+			}
 			else continue; //TODO: Warning
 		}
 		return validate_machine_config(config);
@@ -3,6 +3,7 @@
 #include <ostd/data/Color.hpp>
 #include <map>
 #include "../tools/GlobalData.hpp"
+#include "../hardware/DiskBlockCache.hpp"
 
 namespace dragon
 {
@@ -19,6 +20,19 @@ namespace dragon
 		ostd::Color singleColor_foreground;
 		u8 text16_palette { 0 };
 		u8 screen_redraw_rate_per_second { 10 };
+		u8 disk_io_threads { 1 };
+		hw::DiskBlockCache::tConfig disk_cache { 4096, 8, hw::DiskBlockCache::eWritePolicy::WriteThrough, 8 };
+		String disk_trace_file { "" };
+		bool disk_stats { false };
+		u32 text_scrollback_lines { 1000 };
+		String text_scrollback_file { "" };
+		bool terminal_display { false };
+		String framebuffer_shm { "" };
+		String input_script { "" };
+		String input_script_report { "" };
+		String serial_backend { "" };
+		String host_share { "" };
+		bool host_share_writable { false };
 
 		inline bool isValid(void) const { return m_valid; }
 		inline void destroy(void) { for (auto& ptr : cpuext_list) delete ptr.second; }
@@ -1,7 +1,10 @@
 #include "DragonRuntime.hpp"
+#include "../hardware/WakeupSignal.hpp"
 #include <ogfx/render/PixelRenderer.hpp>
 #include <ostd/io/Memory.hpp>
 #include <ostd/utils/Time.hpp>
+#include <atomic>
+#include <thread>
 
 namespace dragon
 {
@@ -66,6 +69,8 @@ namespace dragon
 				String edit(argv[i]);
 				if (edit == "--verbose-load")
 					args.verbose_load = true;
+				else if (edit == "--headless")
+					args.headless = true;
 				else if (edit == "--force-load")
 				{
 					if ((argc - 1) - i < 2)
@@ -102,10 +107,15 @@ namespace dragon
 			out.fg(ostd::ConsoleColors::Magenta).p("  Initializing virtual display:").nl();
 		i32 w = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_H * ogfx::PixelRenderer::TextRenderer::FONT_CHAR_W; //60 * 16;
 		i32 h = ogfx::PixelRenderer::TextRenderer::CONSOLE_CHARS_V * ogfx::PixelRenderer::TextRenderer::FONT_CHAR_H; //60 * 9;
+		//The terminal backend and headless VMs still need the window for the event loop, but nothing should show up on screen
+		if (machine_config.terminal_display || info.hideVirtualDisplay)
+			SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
 		vDisplay.initialize(w, h, "DragonVM");
 		vDisplay.setFont("font.bmp");
-		if (info.hideVirtualDisplay)
+		if (info.hideVirtualDisplay || machine_config.terminal_display)
 			vDisplay.hide();
+		if (machine_config.framebuffer_shm != "" && !vDisplay.enableSharedFramebuffer(machine_config.framebuffer_shm))
+			out.fg(ostd::ConsoleColors::Red).p("Unable to create shared framebuffer (is the name already in use?): ").p(machine_config.framebuffer_shm.cpp_str()).reset().nl(); //TODO: Error
 		if (info.verboseLoad)
 		{
 			out.fg(ostd::ConsoleColors::BrightYellow);
@@ -116,16 +126,64 @@ namespace dragon
 				out.nl();
 		}
 
+		if (machine_config.input_script != "")
+		{
+			String error = "";
+			if (!inputScript.load(machine_config.input_script, machine_config.clock_rate_sec, error))
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Invalid input script: ").p(error).reset().nl();
+				return RETURN_VAL_INVALID_INPUT_SCRIPT;
+			}
+			if (info.verboseLoad)
+				out.fg(ostd::ConsoleColors::Magenta).p("  Input script loaded: ").fg(ostd::ConsoleColors::BrightYellow).p(machine_config.input_script.cpp_str()).nl();
+		}
+
 		if (machine_config.vdisk_paths.size() == 0) return RETURN_VAL_NO_DISK; //TODO: Error
 		if (info.verboseLoad)
 			out.fg(ostd::ConsoleColors::Magenta).p("  Initializing virtual disks:").nl();
 		for (auto const& disk_path : machine_config.vdisk_paths)
 		{
-			vDisks[disk_path.first] = dragon::hw::VirtualHardDrive(disk_path.second);
+			vDisks[disk_path.first].init(disk_path.second);
+			vDisks[disk_path.first].configureCache(machine_config.disk_cache);
 			vDiskInterface.connectDisk(vDisks[disk_path.first], disk_path.first);
 			if (info.verboseLoad)
 				out.fg(ostd::ConsoleColors::BrightYellow).p("    Disk").p(disk_path.first).p(" connected: ").p(disk_path.second.cpp_str()).nl();
 		}
+		vDiskInterface.startIOEngine(machine_config.disk_io_threads);
+		if (info.verboseLoad)
+		{
+			out.fg(ostd::ConsoleColors::BrightYellow).p("    Disk I/O worker threads: ").p((i32)machine_config.disk_io_threads).nl();
+			out.fg(ostd::ConsoleColors::BrightYellow).p("    Disk cache: ").p((i32)machine_config.disk_cache.capacityMiB).p(" MiB, ");
+			out.p((i32)machine_config.disk_cache.blockSize).p(" byte blocks, ");
+			out.p(machine_config.disk_cache.writePolicy == hw::DiskBlockCache::eWritePolicy::WriteBack ? "write-back" : "write-through").nl();
+		}
+		if (machine_config.serial_backend != "")
+		{
+			String error = "";
+			if (!vSerialInterface.connect(machine_config.serial_backend, error))
+				out.fg(ostd::ConsoleColors::Red).p("Unable to connect the serial port: ").p(error).reset().nl(); //TODO: Error
+			else if (vSerialInterface.getBackend().getType() == hw::SerialBackend::eType::Pty)
+				out.fg(ostd::ConsoleColors::Magenta).p("Serial port attached to: ").fg(ostd::ConsoleColors::BrightYellow).p(vSerialInterface.getBackend().getDevicePath().cpp_str()).reset().nl();
+			else if (info.verboseLoad)
+				out.fg(ostd::ConsoleColors::Magenta).p("  Serial port connected: ").fg(ostd::ConsoleColors::BrightYellow).p(machine_config.serial_backend.cpp_str()).nl();
+		}
+		if (machine_config.host_share != "")
+		{
+			if (!vHostCall.mount(machine_config.host_share, machine_config.host_share_writable))
+				out.fg(ostd::ConsoleColors::Red).p("Unable to share host directory: ").p(machine_config.host_share.cpp_str()).reset().nl(); //TODO: Error
+			else if (info.verboseLoad)
+			{
+				out.fg(ostd::ConsoleColors::Magenta).p("  Host directory shared: ").fg(ostd::ConsoleColors::BrightYellow).p(machine_config.host_share.cpp_str());
+				out.p(machine_config.host_share_writable ? " (read/write)" : " (read only)").nl();
+			}
+		}
+		if (machine_config.disk_trace_file != "")
+		{
+			if (!vDiskInterface.startTrace(machine_config.disk_trace_file))
+				out.fg(ostd::ConsoleColors::Red).p("    Unable to open disk trace file: ").p(machine_config.disk_trace_file.cpp_str()).reset().nl(); //TODO: Error
+			else if (info.verboseLoad)
+				out.fg(ostd::ConsoleColors::BrightYellow).p("    Disk trace: ").p(machine_config.disk_trace_file.cpp_str()).nl();
+		}
 
 		if (info.verboseLoad)
 			out.fg(ostd::ConsoleColors::Magenta).p("  Loading vBIOS file: ").fg(ostd::ConsoleColors::BrightYellow).p(machine_config.bios_path.cpp_str()).nl();
@@ -207,6 +265,16 @@ namespace dragon
 		}
 		memMap.mapDevice(vDiskInterface, dragon::data::MemoryMapAddresses::DiskInterface_Start, dragon::data::MemoryMapAddresses::DiskInterface_End, true, "Disk");
 		if (info.verboseLoad)
+		{
+			out.fg(ostd::ConsoleColors::Magenta).p("    vTimer: ");
+			out.fg(ostd::ConsoleColors::BrightYellow);
+			out.p(String::getHexStr(dragon::data::MemoryMapAddresses::Timer_Start, true, 2).cpp_str());
+			out.p(" to ");
+			out.p(String::getHexStr(dragon::data::MemoryMapAddresses::Timer_End, true, 2).cpp_str());
+			out.p(" (remap=true)").nl();
+		}
+		memMap.mapDevice(vTimer, dragon::data::MemoryMapAddresses::Timer_Start, dragon::data::MemoryMapAddresses::Timer_End, true, "Timer");
+		if (info.verboseLoad)
 		{
 			out.fg(ostd::ConsoleColors::Magenta).p("    vGraphicsInterface: ");
 			out.fg(ostd::ConsoleColors::BrightYellow);
@@ -227,6 +295,16 @@ namespace dragon
 		}
 		memMap.mapDevice(vSerialInterface, dragon::data::MemoryMapAddresses::SerialInterface_Start, dragon::data::MemoryMapAddresses::SerialInterface_End, true, "serial");
 		if (info.verboseLoad)
+		{
+			out.fg(ostd::ConsoleColors::Magenta).p("    vHostCall: ");
+			out.fg(ostd::ConsoleColors::BrightYellow);
+			out.p(String::getHexStr(dragon::data::MemoryMapAddresses::HostCall_Start, true, 2).cpp_str());
+			out.p(" to ");
+			out.p(String::getHexStr(dragon::data::MemoryMapAddresses::HostCall_End, true, 2).cpp_str());
+			out.p(" (remap=true)").nl();
+		}
+		memMap.mapDevice(vHostCall, dragon::data::MemoryMapAddresses::HostCall_Start, dragon::data::MemoryMapAddresses::HostCall_End, true, "hcall");
+		if (info.verboseLoad)
 		{
 			out.fg(ostd::ConsoleColors::Magenta).p("    RAM: ");
 			out.fg(ostd::ConsoleColors::BrightYellow);
@@ -319,32 +397,105 @@ namespace dragon
 
 	void DragonRuntime::shutdownMachine(void)
 	{
+		vDisplay.disableTerminalBackend();
+		vDisplay.disableSharedFramebuffer();
+		vDiskInterface.stopIOEngine();
+		vDiskInterface.stopTrace();
+		vSerialInterface.disconnect();
+		vHostCall.unmount();
+		if (machine_config.disk_stats)
+			__print_disk_stats();
+		if (inputScript.isLoaded())
+			__print_input_script_report();
+		if (machine_config.text_scrollback_file != "" && !vDisplay.getSingleTextLines().saveToFile(machine_config.text_scrollback_file))
+			out.fg(ostd::ConsoleColors::Red).p("Unable to save text scrollback to: ").p(machine_config.text_scrollback_file.cpp_str()).reset().nl(); //TODO: Error
+		//unmount() writes back the dirty cache blocks on its own
+		for (auto& disk : vDisks)
+			disk.second.unmount();
 		machine_config.destroy();
 	}
 
 	void DragonRuntime::runMachine(void)
 	{
-		bool running = true;
-		u8 screenRedrawRate = vCMOS.read8(data::CMOSRegisters::ScreenRedrawRate);
-		f64 cycleUPS = (machine_config.fixed_clock ? machine_config.clock_rate_sec : -1.0);
-		ostd::StepTimer cycleTimer(cycleUPS, [&](f64 dt) {
-			vDisplay.mainLoop();
-			running = cpu.execute() && vDisplay.isRunning();
-			vDiskInterface.cycleStep();
-		});
-		ostd::StepTimer screenTimer(screenRedrawRate, [&](f64 dt) {
-			vDisplay.redrawScreen();
-		});
-		while (running || vDiskInterface.isBusy())
+		//The guest runs on its own thread, while this one owns the window: it pumps events,
+		// rasterizes the frames published by the display and presents them
+		if (machine_config.terminal_display && !vDisplay.enableTerminalBackend())
 		{
-			cycleTimer.update();
-			screenTimer.update();
-			if (dragon::data::ErrorHandler::hasError())
+			out.fg(ostd::ConsoleColors::Red).p("Unable to use the terminal as display: stdin and stdout must be a terminal.").reset().nl(); //TODO: Error
+			return;
+		}
+		std::atomic<bool> windowOpen { true };
+		std::atomic<bool> machineRunning { true };
+		std::thread emulationThread([&]() {
+			bool running = true;
+			u8 screenRedrawRate = vCMOS.read8(data::CMOSRegisters::ScreenRedrawRate);
+			f64 cycleUPS = (machine_config.fixed_clock ? machine_config.clock_rate_sec : -1.0);
+			u64 scriptCheckedFrame = 0;
+			ostd::StepTimer cycleTimer(cycleUPS, [&](f64 dt) {
+				if (inputScript.isLoaded())
+					inputScript.step(cpu.getCycleCount(), vKeyboard);
+				vKeyboard.processPendingEvents();
+				vDisplay.update();
+				if (inputScript.isWaitingForText() && vDisplay.getPublishedFrameCount() != scriptCheckedFrame)
+				{
+					scriptCheckedFrame = vDisplay.getPublishedFrameCount();
+					inputScript.checkScreen(vDisplay.getScreenText());
+				}
+				running = cpu.execute() && windowOpen.load(std::memory_order_relaxed);
+				scheduler.runDue(cpu.getCycleCount());
+				vTimer.cycleStep();
+				vDiskInterface.cycleStep();
+				vSerialInterface.cycleStep();
+			});
+			ostd::StepTimer screenTimer(screenRedrawRate, [&](f64 dt) {
+				vDisplay.redrawScreen();
+			});
+			//Screen refreshes are driven by host time, so an idle vCPU still wakes up for each of them
+			f64 maxIdleSeconds = (screenRedrawRate > 0 ? 1.0 / screenRedrawRate : 0.05);
+			while (running || vDiskInterface.isBusy())
 			{
-				processErrors();
-				break;
+				if (cpu.isIdle() && !vKeyboard.hasUndeliveredEvents() && (!inputScript.isLoaded() || inputScript.isFinished()))
+					__idle_until_interrupt(maxIdleSeconds);
+				cycleTimer.update();
+				screenTimer.update();
+				if (dragon::data::ErrorHandler::hasError())
+				{
+					processErrors();
+					break;
+				}
 			}
+			machineRunning = false;
+		});
+		while (machineRunning && windowOpen)
+		{
+			vDisplay.mainLoop();
+			windowOpen = vDisplay.isRunning() && vDisplay.renderTerminal(vKeyboard);
+		}
+		//Once the window is gone the emulation thread stops on its own (after any in-flight disk I/O), so just wait for it
+		hw::WakeupSignal::notify();
+		emulationThread.join();
+	}
+
+	void DragonRuntime::__idle_until_interrupt(f64 maxSeconds)
+	{
+		u64 now = cpu.getCycleCount();
+		u64 deadline = scheduler.getNextDeadline();
+		if (!machine_config.fixed_clock)
+		{
+			//Unthrottled: virtual time costs nothing, so jump to the cycle right before the next scheduled device event
+			if (deadline > now + 1)
+				cpu.skipCycles(deadline - now - 1);
+			else if (deadline == 0)
+				hw::WakeupSignal::wait(maxSeconds);
+			return;
 		}
+		//Fixed clock: sleep through the host time left until the next deadline,
+		// the cycle timer then catches up on the cycles that went by meanwhile
+		f64 timeout = maxSeconds;
+		if (deadline != 0)
+			timeout = std::min(timeout, (f64)(deadline > now ? deadline - now : 0) / machine_config.clock_rate_sec);
+		if (timeout >= 0.001)
+			hw::WakeupSignal::wait(timeout);
 	}
 
 	void DragonRuntime::forceLoad(const String& filePath, u16 loadAddress)
@@ -360,6 +511,39 @@ namespace dragon
 		}
 	}
 
+	void DragonRuntime::__print_disk_stats(void)
+	{
+		out.nl().fg(ostd::ConsoleColors::Magenta).p("Disk I/O statistics:").nl();
+		for (auto& disk : vDiskInterface.getStats())
+		{
+			auto& stats = disk.second;
+			out.fg(ostd::ConsoleColors::BrightYellow).p("  Disk").p((i32)disk.first).p(": ").p(stats.getRequestCount()).p(" requests (");
+			out.p(stats.getReadCount()).p(" reads, ").p(stats.getWriteCount()).p(" writes, ").p(stats.getFailedCount()).p(" failed)").nl();
+			out.p("    Bytes read: ").p(stats.getBytesRead()).p(", written: ").p(stats.getBytesWritten()).nl();
+			out.p("    Transfer cycles: avg ").p(String("").add(stats.getAverageCycles(), 2)).p(", p99 <= ").p(stats.getP99Cycles()).nl();
+			out.p("    Wall time (us): avg ").p(String("").add(stats.getAverageWallTimeNs() / 1000.0, 2)).p(", p99 <= ").p(String("").add(stats.getP99WallTimeNs() / 1000.0, 2)).nl();
+		}
+		out.reset();
+	}
+
+	void DragonRuntime::__print_input_script_report(void)
+	{
+		out.nl().fg(ostd::ConsoleColors::Magenta).p("Input script markers (").p(inputScript.getCycle()).p(" cycles run");
+		if (!inputScript.isFinished())
+			out.p(", script not finished");
+		out.p("):").nl();
+		for (auto& marker : inputScript.getMarkers())
+		{
+			out.fg(ostd::ConsoleColors::BrightYellow).p("  ").p(marker.name).p(": cycle ").p(marker.cycle).p(", ").p(marker.cyclesSinceInput).p(" cycles after the last input");
+			if (inputScript.getClockRate() > 0)
+				out.p(" (").p(String("").add((marker.cyclesSinceInput * 1000.0) / inputScript.getClockRate(), 2)).p(" ms)");
+			out.nl();
+		}
+		out.reset();
+		if (machine_config.input_script_report != "" && !inputScript.saveReport(machine_config.input_script_report))
+			out.fg(ostd::ConsoleColors::Red).p("Unable to save input script report: ").p(machine_config.input_script_report.cpp_str()).reset().nl(); //TODO: Error
+	}
+
 	void DragonRuntime::__print_application_help(void)
 	{
 		i32 commandLength = 46;
@@ -368,6 +552,9 @@ namespace dragon
 		String tmpCommand = "--verbose-load";
 		tmpCommand.addRightPadding(commandLength);
 		out.fg(ostd::ConsoleColors::Blue).p(tmpCommand).fg(ostd::ConsoleColors::Green).p("Used to show more information while loading the virtual machine.").reset().nl();
+		tmpCommand = "--headless";
+		tmpCommand.addRightPadding(commandLength);
+		out.fg(ostd::ConsoleColors::Blue).p(tmpCommand).fg(ostd::ConsoleColors::Green).p("Runs the virtual machine without a window (see <framebuffer_shm> in the machine config).").reset().nl();
 		tmpCommand = "--force-load <binary-file> <ram-offset>";
 		tmpCommand.addRightPadding(commandLength);
 		out.fg(ostd::ConsoleColors::Blue).p(tmpCommand).fg(ostd::ConsoleColors::Green).p("Injects the specified binary into RAM at the specified offset.").reset().nl();
@@ -6,6 +6,7 @@
 #include "../hardware/VirtualIODevices.hpp"
 #include "../hardware/VirtualHardDrive.hpp"
 #include "../hardware/VirtualDisplay.hpp"
+#include "../hardware/InputScript.hpp"
 
 #include "../tools/GlobalData.hpp"
 
@@ -29,6 +30,7 @@ namespace dragon
 		{
 			String machine_config_path = "";
 			bool verbose_load = false;
+			bool headless = false;
 			bool force_load = false;
 			String force_load_file = "";
 			u16 force_load_mem_offset = 0x00;
@@ -54,12 +56,16 @@ namespace dragon
 
 		private:
 			static void __print_application_help(void);
+			static void __print_disk_stats(void);
+			static void __print_input_script_report(void);
+			static void __idle_until_interrupt(f64 maxSeconds);
 
 		public:
 			inline static ostd::ConsoleOutputHandler out;
 
 			inline static hw::MemoryMapper memMap;
 			inline static hw::VirtualCPU cpu { memMap };
+			inline static hw::EventScheduler scheduler;
 			inline static hw::VirtualRAM ram;
 			inline static hw::InterruptVector intVec;
 			inline static hw::VirtualBIOS vBIOS;
@@ -69,11 +75,14 @@ namespace dragon
 			inline static hw::VirtualMouse vMouse;
 			inline static hw::interface::Disk vDiskInterface { memMap, cpu };
 			inline static hw::interface::Graphics vGraphicsInterface;
-			inline static hw::interface::SerialPort vSerialInterface;
+			inline static hw::interface::SerialPort vSerialInterface { memMap, cpu };
+			inline static hw::interface::HostCall vHostCall { memMap };
+			inline static hw::interface::Timer vTimer { cpu, scheduler };
 
 			inline static std::unordered_map<i32, hw::VirtualHardDrive> vDisks;
 
 			inline static hw::VirtualDisplay vDisplay;
+			inline static hw::InputScript inputScript;
 
 			inline static tMachineConfig machine_config;
 
@@ -88,6 +97,7 @@ namespace dragon
 			inline static const i32 RETURN_VAL_TOO_FEW_ARGUMENTS = 3;
 			inline static const i32 RETURN_VAL_MISSING_PARAM = 4;
 			inline static const i32 RETURN_VAL_PARAMETER_NOT_NUMERIC = 5;
+			inline static const i32 RETURN_VAL_INVALID_INPUT_SCRIPT = 6;
 			inline static const i32 RETURN_VAL_EXIT_SUCCESS = 0;
 
 		friend class SignalListener;
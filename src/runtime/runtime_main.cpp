@@ -14,6 +14,7 @@ int main(int argc, char** argv)
 	dragon::DragonRuntime::tRuntimeInitInfo initInfo;
 	initInfo.configFilePath = args.machine_config_path;
 	initInfo.verboseLoad = args.verbose_load;
+	initInfo.hideVirtualDisplay = args.headless;
 	rValue = dragon::DragonRuntime::initMachine(initInfo);
 	if (rValue == dragon::DragonRuntime::RETURN_VAL_CLOSE_RUNTIME)
 		return 0;
@@ -23,5 +24,6 @@ int main(int argc, char** argv)
 	if (args.force_load)
 		dragon::DragonRuntime::forceLoad(args.force_load_file, args.force_load_mem_offset);
 	dragon::DragonRuntime::runMachine();
+	dragon::DragonRuntime::shutdownMachine();
 	return dragon::DragonRuntime::RETURN_VAL_EXIT_SUCCESS;
 }
@@ -0,0 +1,119 @@
+#include "Compression.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace dragon
+{
+	static inline u32 __lz_read32(const i8* ptr)
+	{
+		u32 value = 0;
+		std::memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+
+	static inline u32 __lz_hash(u32 sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - LZCodec::HashBits);
+	}
+
+	u32 LZCodec::compress(const i8* input, u32 inputSize, ostd::ByteStream& output)
+	{
+		output.clear();
+		output.reserve(inputSize + (inputSize / 255) + 16);
+		std::vector<u32> table(1 << HashBits, 0xFFFFFFFF);
+		u32 anchor = 0;
+		u32 pos = 0;
+		while (inputSize >= MinMatchLength && pos <= inputSize - MinMatchLength)
+		{
+			u32 sequence = __lz_read32(input + pos);
+			u32 hash = __lz_hash(sequence);
+			u32 candidate = table[hash];
+			table[hash] = pos;
+			if (candidate == 0xFFFFFFFF || pos - candidate > MaxOffset || __lz_read32(input + candidate) != sequence)
+			{
+				pos++;
+				continue;
+			}
+			u32 matchLength = MinMatchLength;
+			while (pos + matchLength < inputSize && input[candidate + matchLength] == input[pos + matchLength])
+				matchLength++;
+
+			u32 literalLength = pos - anchor;
+			u8 token = (u8)((std::min<u32>(literalLength, 15) << 4) | std::min<u32>(matchLength - MinMatchLength, 15));
+			output.push_back((i8)token);
+			if (literalLength >= 15)
+				__write_length(output, literalLength - 15);
+			output.insert(output.end(), input + anchor, input + pos);
+			u16 offset = (u16)(pos - candidate);
+			output.push_back((i8)(offset & 0xFF));
+			output.push_back((i8)(offset >> 8));
+			if (matchLength - MinMatchLength >= 15)
+				__write_length(output, matchLength - MinMatchLength - 15);
+
+			pos += matchLength;
+			anchor = pos;
+		}
+		u32 literalLength = inputSize - anchor;
+		output.push_back((i8)(std::min<u32>(literalLength, 15) << 4));
+		if (literalLength >= 15)
+			__write_length(output, literalLength - 15);
+		output.insert(output.end(), input + anchor, input + inputSize);
+		return output.size();
+	}
+
+	bool LZCodec::decompress(const i8* input, u32 inputSize, i8* output, u32 outputSize)
+	{
+		const u8* in = (const u8*)input;
+		const u8* inEnd = in + inputSize;
+		u32 outPos = 0;
+		auto read_length = [&](u32& length) -> bool {
+			u8 b = 255;
+			while (b == 255)
+			{
+				if (in >= inEnd) return false;
+				b = *in++;
+				length += b;
+			}
+			return true;
+		};
+		while (in < inEnd)
+		{
+			u8 token = *in++;
+			u32 literalLength = token >> 4;
+			if (literalLength == 15 && !read_length(literalLength))
+				return false;
+			if (literalLength > (u32)(inEnd - in) || literalLength > outputSize - outPos)
+				return false;
+			std::memcpy(output + outPos, in, literalLength);
+			in += literalLength;
+			outPos += literalLength;
+			if (in == inEnd)
+				break;
+
+			if (inEnd - in < 2) return false;
+			u32 offset = in[0] | (in[1] << 8);
+			in += 2;
+			u32 matchLength = token & 0x0F;
+			if (matchLength == 15 && !read_length(matchLength))
+				return false;
+			matchLength += MinMatchLength;
+			if (offset == 0 || offset > outPos || matchLength > outputSize - outPos)
+				return false;
+			//Byte by byte on purpose: matches may overlap the bytes they produce
+			for (u32 i = 0; i < matchLength; i++, outPos++)
+				output[outPos] = output[outPos - offset];
+		}
+		return outPos == outputSize;
+	}
+
+	void LZCodec::__write_length(ostd::ByteStream& output, u32 length)
+	{
+		while (length >= 255)
+		{
+			output.push_back((i8)255);
+			length -= 255;
+		}
+		output.push_back((i8)length);
+	}
+}
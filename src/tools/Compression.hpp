@@ -0,0 +1,23 @@
+#pragma once
+
+#include <ostd/data/Types.hpp>
+#include <ostd/string/String.hpp>
+
+namespace dragon
+{
+	//Byte oriented LZ77 codec (LZ4-style sequences: token, literals, 16-bit offset, match length)
+	class LZCodec
+	{
+		public:
+			static u32 compress(const i8* input, u32 inputSize, ostd::ByteStream& output);
+			static bool decompress(const i8* input, u32 inputSize, i8* output, u32 outputSize);
+
+		private:
+			static void __write_length(ostd::ByteStream& output, u32 length);
+
+		public:
+			inline static constexpr u32 MinMatchLength = 4;
+			inline static constexpr u32 MaxOffset = 0xFFFF;
+			inline static constexpr u32 HashBits = 14;
+	};
+}
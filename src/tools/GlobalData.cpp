@@ -84,6 +84,7 @@ namespace dragon
 				case data::OpCodes::Ret: return "Ret";
 				case data::OpCodes::ArgReg: return "ArgReg";
 				case data::OpCodes::RetInt: return "RetInt";
+				case data::OpCodes::WaitInt: return "WaitInt";
 				case data::OpCodes::Int: return "Int";
 				case data::OpCodes::Ext01: return "Ext01";
 				case data::OpCodes::Ext02: return "Ext02";
@@ -184,6 +185,7 @@ namespace dragon
 				case data::OpCodes::Ret: return 1;
 				case data::OpCodes::ArgReg: return 2;
 				case data::OpCodes::RetInt: return 1;
+				case data::OpCodes::WaitInt: return 1;
 				case data::OpCodes::Int: return 2;
 				case data::OpCodes::Ext01: return 0;
 				case data::OpCodes::Ext02: return 0;
@@ -204,5 +206,95 @@ namespace dragon
 				default: return 0;
 			}
 		}
+
+		u8 OpCodes::getInstructionCycles(u8 opCode)
+		{
+			//Virtual cycles spent by each instruction: 1 for register work, +1 for each memory access,
+			// more for multiplication/division and for the instructions that save or restore a whole stack frame
+			CPUExtension* ext = DragonRuntime::cpu.getCurrentCPUExtension();
+			if (ext != nullptr)
+				return ext->getInstructionCycles(DragonRuntime::cpu.getCurrentCPUExtensionInstruction());
+			switch (opCode)
+			{
+				case data::OpCodes::NoOp: return 1;
+				case data::OpCodes::DEBUG_Break: return 1;
+				case data::OpCodes::BIOSModeImm: return 1;
+				case data::OpCodes::DEBUG_StartProfile: return 1;
+				case data::OpCodes::DEBUG_StopProfile: return 1;
+				case data::OpCodes::DEBUG_DumpRAM: return 1;
+				case data::OpCodes::MovImmReg: return 1;
+				case data::OpCodes::MovImmMem: return 2;
+				case data::OpCodes::MovRegReg: return 1;
+				case data::OpCodes::MovRegMem: return 2;
+				case data::OpCodes::MovMemReg: return 2;
+				case data::OpCodes::MovDerefRegReg: return 2;
+				case data::OpCodes::MovDerefRegMem: return 3;
+				case data::OpCodes::MovRegDerefReg: return 2;
+				case data::OpCodes::MovMemDerefReg: return 3;
+				case data::OpCodes::MovImmDerefReg: return 2;
+				case data::OpCodes::MovDerefRegDerefReg: return 3;
+				case data::OpCodes::MovByteImmMem: return 2;
+				case data::OpCodes::MovByteRegMem: return 2;
+				case data::OpCodes::MovByteDerefRegMem: return 3;
+				case data::OpCodes::MovByteImmDerefReg: return 2;
+				case data::OpCodes::MovByteRegDerefReg: return 2;
+				case data::OpCodes::MovByteMemDerefReg: return 3;
+				case data::OpCodes::MovByteDerefRegDerefReg: return 3;
+				case data::OpCodes::MovByteMemReg: return 2;
+				case data::OpCodes::MovByteImmReg: return 1;
+				case data::OpCodes::MovByteDerefRegReg: return 2;
+				case data::OpCodes::AddImmReg: return 1;
+				case data::OpCodes::AddRegReg: return 1;
+				case data::OpCodes::SubImmReg: return 1;
+				case data::OpCodes::SubRegReg: return 1;
+				case data::OpCodes::MulImmReg: return 3;
+				case data::OpCodes::MulRegReg: return 3;
+				case data::OpCodes::DivImmReg: return 6;
+				case data::OpCodes::DivRegReg: return 6;
+				case data::OpCodes::IncReg: return 1;
+				case data::OpCodes::DecReg: return 1;
+				case data::OpCodes::RShiftRegImm: return 1;
+				case data::OpCodes::RShiftRegReg: return 1;
+				case data::OpCodes::LShiftRegImm: return 1;
+				case data::OpCodes::LShiftRegReg: return 1;
+				case data::OpCodes::AndRegImm: return 1;
+				case data::OpCodes::AndRegReg: return 1;
+				case data::OpCodes::OrRegImm: return 1;
+				case data::OpCodes::OrRegReg: return 1;
+				case data::OpCodes::XorRegImm: return 1;
+				case data::OpCodes::XorRegReg: return 1;
+				case data::OpCodes::NotReg: return 1;
+				case data::OpCodes::NegReg: return 1;
+				case data::OpCodes::NegByteReg: return 1;
+				case data::OpCodes::JmpNotEqImm: return 2;
+				case data::OpCodes::JmpNotEqReg: return 2;
+				case data::OpCodes::JmpEqImm: return 2;
+				case data::OpCodes::JmpEqReg: return 2;
+				case data::OpCodes::JmpGrImm: return 2;
+				case data::OpCodes::JmpGrReg: return 2;
+				case data::OpCodes::JmpLessImm: return 2;
+				case data::OpCodes::JmpLessReg: return 2;
+				case data::OpCodes::JmpGeImm: return 2;
+				case data::OpCodes::JmpGeReg: return 2;
+				case data::OpCodes::JmpLeImm: return 2;
+				case data::OpCodes::JmpLeReg: return 2;
+				case data::OpCodes::Jmp: return 2;
+				case data::OpCodes::Halt: return 1;
+				case data::OpCodes::PushImm: return 2;
+				case data::OpCodes::PushReg: return 2;
+				case data::OpCodes::PopReg: return 2;
+				case data::OpCodes::CallImm: return 8;
+				case data::OpCodes::CallReg: return 8;
+				case data::OpCodes::Ret: return 8;
+				case data::OpCodes::ArgReg: return 2;
+				case data::OpCodes::ZeroFlag: return 1;
+				case data::OpCodes::SetFlag: return 1;
+				case data::OpCodes::ToggleFlag: return 1;
+				case data::OpCodes::WaitInt: return 1;
+				case data::OpCodes::RetInt: return 8;
+				case data::OpCodes::Int: return 8;
+				default: return 1;
+			}
+		}
 	}
 }
\ No newline at end of file
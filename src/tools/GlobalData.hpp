@@ -2,6 +2,7 @@
 
 #include <ostd/data/Types.hpp>
 #include <ostd/data/Color.hpp>
+#include <mutex>
 
 namespace dragon
 {
@@ -58,6 +59,15 @@ namespace dragon
 				inline static constexpr u64 Graphics_MemoryReadFailed            =             0x8000000000000000;
 				inline static constexpr u64 Graphics_MemoryWriteFailed            =             0x8000000000000001;
 
+				inline static constexpr u64 Serial_ControllerReadFailed        =             0x9000000000000000;
+				inline static constexpr u64 Serial_ControllerWriteFailed        =             0x9000000000000001;
+
+				inline static constexpr u64 HostCall_ControllerReadFailed        =             0xA000000000000000;
+				inline static constexpr u64 HostCall_ControllerWriteFailed        =             0xA000000000000001;
+
+				inline static constexpr u64 Timer_ControllerReadFailed            =             0xB000000000000000;
+				inline static constexpr u64 Timer_ControllerWriteFailed        =             0xB000000000000001;
+
 		};
 
 		class ErrorHandler
@@ -69,10 +79,11 @@ namespace dragon
 			};
 
 			public:
-				inline static void pushError(u64 code, String text) { m_errorStack.push_back({ code, text }); }
-				inline static bool hasError(void) { return m_errorStack.size() > 0; }
+				inline static void pushError(u64 code, String text) { std::lock_guard<std::mutex> lock(m_errorLock); m_errorStack.push_back({ code, text }); }
+				inline static bool hasError(void) { std::lock_guard<std::mutex> lock(m_errorLock); return m_errorStack.size() > 0; }
 				inline static tError popError(void)
 				{
+					std::lock_guard<std::mutex> lock(m_errorLock);
 					if (m_errorStack.size() == 0)
 						return { ErrorCodes::NoError, "No Errors." };
 					tError err = m_errorStack[m_errorStack.size() - 1];
@@ -82,6 +93,7 @@ namespace dragon
 
 			private:
 				inline static std::vector<tError> m_errorStack;
+				inline static std::mutex m_errorLock;
 		};
 
 		class MemoryMapAddresses
@@ -106,13 +118,19 @@ namespace dragon
 				inline static constexpr u16 MBR_End   = 0x157F;
 
 				inline static constexpr u16 DiskInterface_Start = 0x1580;
-				inline static constexpr u16 DiskInterface_End   = 0x15FF;
+				inline static constexpr u16 DiskInterface_End   = 0x15BF;
+
+				inline static constexpr u16 Timer_Start = 0x15C0;
+				inline static constexpr u16 Timer_End   = 0x15FF;
 
 				inline static constexpr u16 VideoCardInterface_Start = 0x1600;
 				inline static constexpr u16 VideoCardInterface_End   = 0x16FF;
 
 				inline static constexpr u16 SerialInterface_Start = 0x1700;
-				inline static constexpr u16 SerialInterface_End   = 0x173F;
+				inline static constexpr u16 SerialInterface_End   = 0x171F;
+
+				inline static constexpr u16 HostCall_Start = 0x1720;
+				inline static constexpr u16 HostCall_End   = 0x173F;
 
 				inline static constexpr u16 Memory_Start = 0x1740;
 				inline static constexpr u16 Memory_End   = 0xFFFF;
@@ -195,9 +213,17 @@ namespace dragon
 		{
 			public:
 				inline static constexpr u8 DiskInterfaceFFinished = 0x80;
+				inline static constexpr u8 DiskQueueBatchFinished = 0x81;
+				inline static constexpr u8 TimerChannel0 = 0x88;
+				inline static constexpr u8 TimerChannel1 = 0x89;
+				inline static constexpr u8 TimerChannel2 = 0x8A;
+				inline static constexpr u8 TimerChannel3 = 0x8B;
+				inline static constexpr u8 SerialDataReceived = 0x90;
+				inline static constexpr u8 SerialTransmitEmpty = 0x91;
 				inline static constexpr u8 KeyPressed = 0xA0;
 				inline static constexpr u8 KeyReleased = 0xA1;
 				inline static constexpr u8 TextEntered = 0xA2;
+				inline static constexpr u8 KeyboardEventsQueued = 0xA3;
 
 				inline static constexpr u8 Text16ModeScreenRefreshed = 0xE0;
 
@@ -206,9 +232,17 @@ namespace dragon
 					switch (code)
 					{
 						case DiskInterfaceFFinished:     return "Disk_Interface_Finished";
+						case DiskQueueBatchFinished:     return "Disk_Queue_Batch_Finished";
+						case TimerChannel0:              return "Timer_Channel_0";
+						case TimerChannel1:              return "Timer_Channel_1";
+						case TimerChannel2:              return "Timer_Channel_2";
+						case TimerChannel3:              return "Timer_Channel_3";
+						case SerialDataReceived:         return "Serial_Data_Received";
+						case SerialTransmitEmpty:        return "Serial_Transmit_Empty";
 						case KeyPressed:                 return "Key_Pressed";
 						case KeyReleased:                 return "Key_Released";
 						case TextEntered:                 return "Text_Entered";
+						case KeyboardEventsQueued:        return "Keyboard_Events_Queued";
 						case Text16ModeScreenRefreshed:    return "Text16_Mode_Screen_Refreshed";
 						default:                        return "UNKNOWN";
 					}
@@ -281,6 +315,7 @@ namespace dragon
 				inline CPUExtension(u8 code, String name) : m_code(code), m_name(name) {  }
 				virtual String getOpCodeString(u8 opCode) = 0;
 				virtual u8 getInstructionSIze(u8 opCode) = 0;
+				virtual u8 getInstructionCycles(u8 opCode) = 0;
 				virtual bool execute(hw::VirtualCPU& vcpu) = 0;
 
 			public:
@@ -390,18 +425,21 @@ namespace dragon
 				inline static constexpr u8 ZeroFlag = 0xF0;
 				inline static constexpr u8 SetFlag = 0xF1;
 				inline static constexpr u8 ToggleFlag = 0xF2;
+				inline static constexpr u8 WaitInt = 0xFC;
 				inline static constexpr u8 RetInt = 0xFD;
 				inline static constexpr u8 Int = 0xFE;
 				inline static constexpr u8 Halt = 0xFF;
 
 				static String getOpCodeString(u8 opCode);
 				static u8 getInstructionSIze(u8 opCode);
+				static u8 getInstructionCycles(u8 opCode);
 		};
 
 		class DefaultValues
 		{
 			public:
 				inline static constexpr u8 MaxMemoryExtensionPages = 255;
+				inline static constexpr u32 MaxTextScrollbackLines = 100000;
 		};
 	}
 }
@@ -2,25 +2,57 @@
 
 #include <ostd/data/Color.hpp>
 #include <ostd/io/IOHandlers.hpp>
+#include <ostd/io/File.hpp>
+#include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <map>
+#include <bit>
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "../hardware/VirtualHardDrive.hpp"
+#include "../hardware/DiskImage.hpp"
+#include "../hardware/DiskTrace.hpp"
+#include "../hardware/SharedFramebuffer.hpp"
 #include "GlobalData.hpp"
 #include "../debugger/DisassemblyLoader.hpp"
+#include "../assembler/Assembler.hpp"
 #include <ostd/io/Memory.hpp>
 #include "../tools/LegacyOstdSerial.hpp"
 
 namespace dragon
 {
-	bool Tools::createVirtualHardDrive(u32 sizeInBytes, const String& dataFilePath)
+	bool Tools::createVirtualHardDrive(u64 sizeInBytes, const String& dataFilePath, bool preallocate)
 	{
-		std::ofstream rf(dataFilePath.cpp_str(), std::ios::out | std::ios::binary);
+		std::ofstream rf(dataFilePath.cpp_str(), std::ios::out | std::ios::binary | std::ios::trunc);
 		if(!rf) return false;
-		ostd::ByteStream stream;
-		for (i32 i = 0; i < sizeInBytes; i++)
-			stream.push_back(0x00);
-		rf.write((char*)(&stream[0]), stream.size());
 		rf.close();
-		return true;
+		if (preallocate)
+		{
+			//Actually reserve every block on the host, so writes can't fail later with a full host disk
+#ifdef _WIN32
+			std::ofstream zf(dataFilePath.cpp_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if(!zf) return false;
+			ostd::ByteStream zeros(std::min<u64>(sizeInBytes, PreallocateChunkSize), 0);
+			for (u64 written = 0; written < sizeInBytes; written += zeros.size())
+				zf.write((char*)zeros.data(), std::min<u64>(zeros.size(), sizeInBytes - written));
+			return (bool)zf;
+#else
+			i32 fd = open(dataFilePath.cpp_str().c_str(), O_WRONLY);
+			if (fd < 0) return false;
+			bool result = posix_fallocate(fd, 0, (off_t)sizeInBytes) == 0;
+			close(fd);
+			return result;
+#endif
+		}
+		//Sparse file: constant time and memory, unwritten ranges read back as zeros
+		std::error_code err;
+		std::filesystem::resize_file(dataFilePath.cpp_str(), sizeInBytes, err);
+		return !err;
 	}
 
 	i32 Tools::execute(int argc, char** argv)
@@ -60,6 +92,42 @@ namespace dragon
 			if (rValue != ErrorNoError)
 				return rValue;
 		}
+		else if (tool == "new-overlay")
+		{
+			rValue = tool_new_overlay(argc, argv);
+			if (rValue != ErrorNoError)
+				return rValue;
+		}
+		else if (tool == "compress-vdisk")
+		{
+			rValue = tool_compress_vdisk(argc, argv);
+			if (rValue != ErrorNoError)
+				return rValue;
+		}
+		else if (tool == "decompress-vdisk")
+		{
+			rValue = tool_decompress_vdisk(argc, argv);
+			if (rValue != ErrorNoError)
+				return rValue;
+		}
+		else if (tool == "build-image")
+		{
+			rValue = tool_build_image(argc, argv);
+			if (rValue != ErrorNoError)
+				return rValue;
+		}
+		else if (tool == "disk-trace")
+		{
+			rValue = tool_disk_trace(argc, argv);
+			if (rValue != ErrorNoError)
+				return rValue;
+		}
+		else if (tool == "fb-view")
+		{
+			rValue = tool_framebuffer_view(argc, argv);
+			if (rValue != ErrorNoError)
+				return rValue;
+		}
 		else if (tool == "--help")
 		{
 			print_application_help();
@@ -79,17 +147,34 @@ namespace dragon
 		if (argc < 4)
 		{
 			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
-			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools new-vdisk <destination_file> <size_in_bytes>").reset().nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools new-vdisk <destination_file> <size_in_bytes> [--preallocate]").reset().nl();
 			return ErrorNewVDiskTooFewArgs;
 		}
 		String dest = argv[2];
 		String str_size = argv[3];
-		if (!str_size.isInt())
+		if (!str_size.isInt() || str_size.startsWith("-"))
 		{
 			out.fg(ostd::ConsoleColors::Red).p("Error: <size_in_bytes> parameter must be integer.").reset().nl();
 			return ErrorNewVDiskNonIntSize;
 		}
-		bool result = createVirtualHardDrive(str_size.toInt(), dest);
+		u64 size = 0;
+		if (!parse_unsigned(str_size, MaxVirtualDiskSize, size) || size == 0)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: <size_in_bytes> must be between 1 and 4294967296 (the Disk Interface addresses 4 GiB).").reset().nl();
+			return ErrorNewVDiskInvalidSize;
+		}
+		bool preallocate = false;
+		for (i32 i = 4; i < argc; i++)
+		{
+			if (String(argv[i]) == "--preallocate")
+				preallocate = true;
+			else
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: Unknown option: ").p(argv[i]).reset().nl();
+				return ErrorNewVDiskUnknownOption;
+			}
+		}
+		bool result = createVirtualHardDrive(size, dest, preallocate);
 		if (!result)
 		{
 			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to create virtual disk.").reset().nl();
@@ -97,7 +182,8 @@ namespace dragon
 		}
 		out.nl().fg(ostd::ConsoleColors::Green).p("Success. Virtual disk created:").nl();
 		out.p("  Path: ").p(dest.cpp_str()).nl();
-		out.p("  Size: ").p(str_size.cpp_str()).reset().nl();
+		out.p("  Size: ").p(str_size.cpp_str()).nl();
+		out.p("  Allocation: ").p(preallocate ? "preallocated" : "sparse").reset().nl();
 		return ErrorNoError;
 	}
 
@@ -129,13 +215,8 @@ namespace dragon
 			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to load data file.").reset().nl();
 			return ErrorLoadProgUnableToLoadDataFile;
 		}
-		i16 index = 0;
 		u32 addr = (u32)str_addr.toInt();
-		for (auto& b : code)
-		{
-			vHDD.write(addr + index, b);
-			index++;
-		}
+		vHDD.write(addr, code);
 		vHDD.unmount();
 		out.nl().fg(ostd::ConsoleColors::Green).p("Success. Data written to Virtual Disk:").nl();
 		out.p("  Data Path: ").p(data_file.cpp_str()).nl();
@@ -295,26 +376,12 @@ namespace dragon
 			}
 			return -1;
 		};
-		auto make_bytestream = [](u16 size, ostd::Byte value = 0xFF) -> ostd::ByteStream {
-
-			ostd::ByteStream stream;
-			for (i16 i = 0; i < size; i++)
-				stream.push_back(value);
-			return stream;
-		};
-		struct tPartData {
-			u32 size { 0 };
-			u32 address { 0 };
-			std::vector<u8> flags;
-			String label { "" };
-		};
-
-		std::vector<tPartData> partitions;
+		std::vector<tDPTPartition> partitions;
 
 		i32 arg_index = 3;
 		bool has_args = true;
 		bool part_started = false;
-		tPartData _part_data;
+		tDPTPartition _part_data;
 		u32 part_start_addr = data::DPTStructure::DiskStartAddr;
 		while (has_args)
 		{
@@ -326,7 +393,7 @@ namespace dragon
 				{
 					part_started = false;
 					partitions.push_back(_part_data);
-					_part_data = tPartData();
+					_part_data = tDPTPartition();
 					continue;
 				}
 				else if (arg.new_toLower() == "-l")
@@ -396,6 +463,383 @@ namespace dragon
 			return ErrorNewDPTTooManyPartitions;
 		}
 
+		vHDD.write(data::DPTStructure::DiskAddress, build_dpt_block(partitions));
+		vHDD.unmount();
+		out.nl().fg(ostd::ConsoleColors::Green).p("Success. DPT Block created on Virtual Disk:").nl();
+		out.p("  Disk Path: ").p(vdisk_file.cpp_str()).nl();
+		out.p("  DPT Block Address: ").p(String::getHexStr(data::DPTStructure::DiskAddress, true, 4).cpp_str()).nl();
+		out.p("  DPT Block Size: ").p(data::DPTStructure::DPTBlockSizeBytes).nl();
+		return ErrorNoError;
+	}
+
+	i32 Tools::tool_build_image(int argc, char** argv)
+	{
+		if (argc < 3)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools build-image <manifest_file> [destination_file]").reset().nl();
+			return ErrorBuildImageTooFewArgs;
+		}
+		String manifest_file = argv[2];
+		ostd::TextFileBuffer file(manifest_file.cpp_str());
+		if (!file.exists())
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to load manifest file.").reset().nl();
+			return ErrorBuildImageInvalidManifest;
+		}
+		struct tSegment {
+			u64 address { 0 };
+			ostd::ByteStream data;
+			String source { "" };
+		};
+		auto manifest_error = [](i32 line_nr, const String& message) -> i32 {
+			out.fg(ostd::ConsoleColors::Red).p("Error (manifest line ").p(line_nr).p("): ").p(message).reset().nl();
+			return ErrorBuildImageInvalidManifest;
+		};
+
+		String dest = "";
+		u64 disk_size = 0;
+		std::vector<tDPTPartition> partitions;
+		std::vector<tSegment> segments;
+		u64 part_start_addr = data::DPTStructure::DiskStartAddr;
+		auto lines = file.getLines();
+		i32 line_nr = 0;
+		for (auto& line : lines)
+		{
+			line_nr++;
+			String lineEdit = line;
+			lineEdit.trim();
+			if (lineEdit == "" || lineEdit.startsWith("#")) continue;
+			if (!lineEdit.contains("="))
+				return manifest_error(line_nr, "expected <key = value>.");
+			auto tokens = lineEdit.tokenize("=");
+			if (tokens.count() != 2)
+				return manifest_error(line_nr, "expected <key = value>.");
+			String key = tokens.next();
+			key.trim().toLower();
+			String value = tokens.next();
+			value.trim();
+			if (key == "output")
+				dest = value;
+			else if (key == "size")
+			{
+				if (!parse_unsigned(value, MaxVirtualDiskSize, disk_size) || disk_size == 0)
+					return manifest_error(line_nr, "<size> must be an integer between 1 and 4294967296.");
+			}
+			else if (key == "include")
+			{
+				if (!value.endsWith("/"))
+					value.add("/");
+				code::Assembler::Application::args.include_directories.push_back(value);
+			}
+			else if (key == "partition")
+			{
+				//partition = SIZE, LABEL [, FLAG ...]   (use - for an empty label)
+				auto fields = value.tokenize(",");
+				if (fields.count() < 2)
+					return manifest_error(line_nr, "expected <partition = SIZE, LABEL [, FLAG ...]>.");
+				if (partitions.size() >= data::DPTStructure::MaxPartCount)
+					return manifest_error(line_nr, String("too many partitions. Maximum is ").add((i32)data::DPTStructure::MaxPartCount).add("."));
+				tDPTPartition part;
+				u64 part_size = 0;
+				if (!parse_unsigned(fields.next(), 0xFFFFFFFF, part_size) || part_size == 0)
+					return manifest_error(line_nr, "partition size must be an integer between 1 and 4294967295.");
+				if (part_start_addr + part_size > MaxVirtualDiskSize)
+					return manifest_error(line_nr, "partition ends past the 4 GiB the Disk Interface can address.");
+				part.label = fields.next();
+				part.label.trim();
+				if (part.label == "-")
+					part.label = "";
+				while (fields.hasNext())
+				{
+					String flag_str = fields.next();
+					flag_str.trim().toLower();
+					i8 flag = -1;
+					for (auto& flag_entry : m_dpt_flags_str)
+					{
+						if (flag_entry.second == flag_str)
+							flag = flag_entry.first;
+					}
+					if (flag < 0)
+						return manifest_error(line_nr, String("unknown partition flag: ").add(flag_str));
+					part.flags.push_back(flag);
+				}
+				part.address = (u32)part_start_addr;
+				part.size = (u32)part_size;
+				part_start_addr += part.size;
+				partitions.push_back(part);
+			}
+			else if (key == "binary")
+			{
+				//binary = FILE @ ADDRESS   (.dss files are assembled, anything else is copied as is)
+				auto fields = value.tokenize("@");
+				if (fields.count() != 2)
+					return manifest_error(line_nr, "expected <binary = FILE @ ADDRESS>.");
+				tSegment segment;
+				segment.source = fields.next();
+				segment.source.trim();
+				if (!parse_unsigned(fields.next(), MaxVirtualDiskSize - 1, segment.address))
+					return manifest_error(line_nr, "binary address must be an integer between 0 and 4294967295.");
+				if (segment.source.new_toLower().endsWith(".dss"))
+				{
+					segment.data = code::Assembler::assembleFromFile(segment.source);
+					if (segment.data.size() == 0)
+					{
+						out.fg(ostd::ConsoleColors::Red).p("Error: Unable to assemble source file: ").p(segment.source).reset().nl();
+						return ErrorBuildImageAssemblyFailed;
+					}
+				}
+				else if (!ostd::Memory::loadByteStreamFromFile(segment.source, segment.data))
+				{
+					out.fg(ostd::ConsoleColors::Red).p("Error: Unable to load data file: ").p(segment.source).reset().nl();
+					return ErrorBuildImageUnableToLoadDataFile;
+				}
+				segments.push_back(segment);
+			}
+			else
+				return manifest_error(line_nr, String("unknown key: ").add(key));
+		}
+		if (argc > 3)
+			dest = argv[3];
+		if (dest == "" || disk_size == 0)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: The manifest must specify <size>, and <output> unless [destination_file] is given.").reset().nl();
+			return ErrorBuildImageInvalidManifest;
+		}
+		if (partitions.size() > 0)
+		{
+			if (part_start_addr > disk_size)
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: Not enough space on disk for the partitions.").reset().nl();
+				return ErrorBuildImageDiskOverflow;
+			}
+			tSegment dpt;
+			dpt.address = data::DPTStructure::DiskAddress;
+			dpt.data = build_dpt_block(partitions);
+			dpt.source = "<DPT-BLOCK>";
+			segments.push_back(dpt);
+		}
+
+		//Lay everything out in address order, so the image is written front to back in one pass
+		std::sort(segments.begin(), segments.end(), [](const tSegment& a, const tSegment& b) { return a.address < b.address; });
+		for (i32 i = 0; i < segments.size(); i++)
+		{
+			auto& segment = segments[i];
+			if (segment.address + segment.data.size() > disk_size)
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: ").p(segment.source).p(" does not fit on the disk.").reset().nl();
+				return ErrorBuildImageDiskOverflow;
+			}
+			if (i > 0 && segments[i - 1].address + segments[i - 1].data.size() > segment.address)
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: ").p(segment.source).p(" overlaps ").p(segments[i - 1].source).p(".").reset().nl();
+				return ErrorBuildImageOverlap;
+			}
+		}
+		if (!createVirtualHardDrive(disk_size, dest))
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to create virtual disk.").reset().nl();
+			return ErrorBuildImageUnable;
+		}
+		std::fstream image(dest.cpp_str(), std::ios::in | std::ios::out | std::ios::binary);
+		for (auto& segment : segments)
+		{
+			if (segment.data.size() == 0) continue;
+			image.seekp(segment.address);
+			image.write((char*)segment.data.data(), segment.data.size());
+		}
+		image.close();
+		if (!image)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to write virtual disk.").reset().nl();
+			return ErrorBuildImageUnable;
+		}
+
+		out.nl().fg(ostd::ConsoleColors::Green).p("Success. Disk image built:").nl();
+		out.p("  Path: ").p(dest.cpp_str()).nl();
+		out.p("  Size: ").p(disk_size).nl();
+		out.p("  Partitions: ").p((i32)partitions.size()).nl();
+		for (auto& segment : segments)
+			out.p("  ").p(String::getHexStr((u32)segment.address, true, 4).cpp_str()).p("  ").p(segment.source).p(" (").p((i32)segment.data.size()).p(" bytes)").nl();
+		out.reset();
+		return ErrorNoError;
+	}
+
+	i32 Tools::tool_disk_trace(int argc, char** argv)
+	{
+		if (argc < 3)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools disk-trace <trace_file>").reset().nl();
+			return ErrorDiskTraceTooFewArgs;
+		}
+		String trace_file = argv[2];
+		std::vector<hw::DiskTraceFile::tRecord> records;
+		if (!hw::DiskTraceFile::load(trace_file, records))
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to load disk trace file.").reset().nl();
+			return ErrorDiskTraceInvalidFile;
+		}
+		struct tDiskSummary {
+			hw::DiskIOStats stats;
+			std::vector<u64> cycles;
+			std::vector<u64> wallTimes;
+			u64 sequential { 0 };
+			u64 smallRequests { 0 };
+			u64 repeatedReads { 0 };
+			u64 queued { 0 };
+			u32 nextAddress { 0xFFFFFFFF };
+			std::unordered_map<u64, u32> readCounts;
+		};
+		auto percentile = [](std::vector<u64>& values, f64 p) -> u64 {
+			if (values.size() == 0) return 0;
+			std::sort(values.begin(), values.end());
+			u64 index = (u64)(p * (values.size() - 1));
+			return values[index];
+		};
+		std::map<u8, tDiskSummary> disks;
+		for (auto& record : records)
+		{
+			auto& disk = disks[record.disk];
+			u64 cycles = record.endCycle - record.startCycle;
+			disk.stats.addSample(record.write, record.size, record.success, cycles, record.wallTimeNs);
+			disk.cycles.push_back(cycles);
+			disk.wallTimes.push_back(record.wallTimeNs);
+			if (record.address == disk.nextAddress)
+				disk.sequential++;
+			disk.nextAddress = record.address + record.size;
+			if (record.size < SmallDiskRequestBytes)
+				disk.smallRequests++;
+			if (record.source == hw::DiskTraceFile::tSourceValues::Queue)
+				disk.queued++;
+			if (!record.write && disk.readCounts[((u64)record.address << 16) | record.size]++ > 0)
+				disk.repeatedReads++;
+		}
+
+		out.fg(ostd::ConsoleColors::BrightRed).p("Trace: ").p(trace_file).p(" (").p((i32)records.size()).p(" requests)").nl();
+		for (auto& entry : disks)
+		{
+			auto& disk = entry.second;
+			auto& stats = disk.stats;
+			f64 count = (f64)stats.getRequestCount();
+			out.nl().fg(ostd::ConsoleColors::Blue).p("Disk").p((i32)entry.first).nl();
+			out.fg(ostd::ConsoleColors::Cyan);
+			out.p("  Requests:          ").p(stats.getRequestCount()).p(" (").p(stats.getReadCount()).p(" reads, ").p(stats.getWriteCount()).p(" writes, ").p(stats.getFailedCount()).p(" failed, ").p(disk.queued).p(" queued)").nl();
+			out.p("  Bytes:             ").p(stats.getBytesRead()).p(" read, ").p(stats.getBytesWritten()).p(" written").nl();
+			out.p("  Transfer cycles:   avg ").p(String("").add(stats.getAverageCycles(), 2)).p(", p99 ").p(percentile(disk.cycles, 0.99)).nl();
+			out.p("  Wall time (us):    avg ").p(String("").add(stats.getAverageWallTimeNs() / 1000.0, 2)).p(", p99 ").p(String("").add(percentile(disk.wallTimes, 0.99) / 1000.0, 2)).nl();
+			out.p("  Sequential:        ").p(String("").add(disk.sequential * 100.0 / count, 1)).p("%").nl();
+			out.fg(disk.smallRequests * 2 > stats.getRequestCount() ? ostd::ConsoleColors::Yellow : ostd::ConsoleColors::Cyan);
+			out.p("  Small (< ").p((i32)SmallDiskRequestBytes).p(" B):     ").p(disk.smallRequests).p(" (").p(String("").add(disk.smallRequests * 100.0 / count, 1)).p("%)").nl();
+			out.fg(disk.repeatedReads * 4 > stats.getReadCount() ? ostd::ConsoleColors::Yellow : ostd::ConsoleColors::Cyan);
+			out.p("  Repeated reads:    ").p(disk.repeatedReads).p(" (same address and size read more than once)").nl();
+		}
+		out.reset().nl();
+		return ErrorNoError;
+	}
+
+	i32 Tools::tool_framebuffer_view(int argc, char** argv)
+	{
+		if (argc < 3)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools fb-view <shm_name> [--snapshot <image_file>] [--watch <seconds>]").reset().nl();
+			return ErrorFramebufferViewTooFewArgs;
+		}
+		String shm_name = argv[2];
+		String snapshot_file = "";
+		i32 watch_seconds = 0;
+		for (i32 i = 3; i < argc; i++)
+		{
+			String option = argv[i];
+			if (option == "--snapshot" && i + 1 < argc)
+				snapshot_file = argv[++i];
+			else if (option == "--watch" && i + 1 < argc && String(argv[i + 1]).isInt())
+				watch_seconds = std::max(0, (i32)String(argv[++i]).toInt());
+			else
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: Invalid option: ").p(argv[i]).reset().nl();
+				return ErrorFramebufferViewInvalidArg;
+			}
+		}
+		hw::SharedFramebuffer framebuffer;
+		if (!framebuffer.open(shm_name))
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to open shared framebuffer: ").p(shm_name).reset().nl();
+			return ErrorFramebufferViewUnableToOpen;
+		}
+		auto& header = framebuffer.getHeader();
+		//Seqlock read: the pixels are used straight from the mapping, and the work is retried if the VM wrote a frame meanwhile
+		auto read_frame_count = [&](void) -> u64 {
+			while (true)
+			{
+				u32 sequence = framebuffer.beginRead();
+				u64 frames = header.frameCount;
+				if (framebuffer.validateRead(sequence))
+					return frames;
+			}
+		};
+		out.fg(ostd::ConsoleColors::BrightRed).p("Framebuffer: ").p(hw::SharedFramebuffer::normalizeName(shm_name)).nl();
+		out.fg(ostd::ConsoleColors::Cyan);
+		out.p("  Size:    ").p(header.width).p("x").p(header.height).p(" (").p(header.stride).p(" bytes per line)").nl();
+		out.p("  Frames:  ").p(read_frame_count()).reset().nl();
+
+		if (snapshot_file != "")
+		{
+			std::vector<u8> rgb(header.width * header.height * 3);
+			auto channel = [](u32 pixel, u32 mask) -> u8 {
+				if (mask == 0) return 0;
+				return (u8)((pixel & mask) >> std::countr_zero(mask));
+			};
+			while (true)
+			{
+				u32 sequence = framebuffer.beginRead();
+				for (u32 y = 0; y < header.height; y++)
+				{
+					const u32* line = (const u32*)(framebuffer.getPixels() + (y * header.stride));
+					u8* dest = rgb.data() + (y * header.width * 3);
+					for (u32 x = 0; x < header.width; x++)
+					{
+						dest[(x * 3) + 0] = channel(line[x], header.redMask);
+						dest[(x * 3) + 1] = channel(line[x], header.greenMask);
+						dest[(x * 3) + 2] = channel(line[x], header.blueMask);
+					}
+				}
+				if (framebuffer.validateRead(sequence))
+					break;
+			}
+			std::ofstream image(snapshot_file.cpp_str(), std::ios::binary);
+			image << "P6\n" << header.width << " " << header.height << "\n255\n";
+			image.write((const char*)rgb.data(), rgb.size());
+			if (!image)
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: Unable to save snapshot: ").p(snapshot_file).reset().nl();
+				return ErrorFramebufferViewUnableToSave;
+			}
+			out.fg(ostd::ConsoleColors::Green).p("Snapshot saved (PPM): ").p(snapshot_file).reset().nl();
+		}
+
+		u64 last_frames = read_frame_count();
+		for (i32 i = 0; i < watch_seconds; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			u64 frames = read_frame_count();
+			out.fg(ostd::ConsoleColors::Cyan).p("  Frame ").p(frames).p(" (").p(frames - last_frames).p(" fps)").reset().nl();
+			last_frames = frames;
+		}
+		return ErrorNoError;
+	}
+
+	ostd::ByteStream Tools::build_dpt_block(std::vector<tDPTPartition>& partitions)
+	{
+		auto make_bytestream = [](u16 size, ostd::Byte value = 0xFF) -> ostd::ByteStream {
+
+			ostd::ByteStream stream;
+			for (i16 i = 0; i < size; i++)
+				stream.push_back(value);
+			return stream;
+		};
+
 		//HEADER
 		ostd::StreamIndex addr = 0;
 		ostd::serial::SerialIO dpt_block(data::DPTStructure::DPTBlockSizeBytes);
@@ -436,19 +880,7 @@ namespace dragon
 			dpt_block.w_String(addr, part.label, false, true);
 			addr += data::DPTStructure::EntryLabelSizeBytes;
 		}
-
-		i16 index = 0;
-		for (auto& b : dpt_block.getData())
-		{
-			vHDD.write(data::DPTStructure::DiskAddress + index, b);
-			index++;
-		}
-		vHDD.unmount();
-		out.nl().fg(ostd::ConsoleColors::Green).p("Success. DPT Block created on Virtual Disk:").nl();
-		out.p("  Disk Path: ").p(vdisk_file.cpp_str()).nl();
-		out.p("  DPT Block Address: ").p(String::getHexStr(data::DPTStructure::DiskAddress, true, 4).cpp_str()).nl();
-		out.p("  DPT Block Size: ").p(data::DPTStructure::DPTBlockSizeBytes).nl();
-		return ErrorNoError;
+		return dpt_block.getData();
 	}
 
 	i32 Tools::tool_print_disassembly(int argc, char** argv)
@@ -524,6 +956,120 @@ namespace dragon
 		return ErrorNoError;
 	}
 
+	i32 Tools::tool_new_overlay(int argc, char** argv)
+	{
+		if (argc < 4)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools new-overlay <destination_file> <base_virtual_disk_file> [block_size]").reset().nl();
+			return ErrorNewOverlayTooFewArgs;
+		}
+		String dest = argv[2];
+		String base = argv[3];
+		u32 block_size = hw::OverlayDiskImage::tStructure::DefaultBlockSize;
+		if (argc > 4)
+		{
+			String str_block_size = argv[4];
+			if (!str_block_size.isInt() || str_block_size.toInt() <= 0)
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: [block_size] parameter must be a positive integer.").reset().nl();
+				return ErrorNewOverlayNonIntBlockSize;
+			}
+			block_size = (u32)str_block_size.toInt();
+		}
+		if (!hw::OverlayDiskImage::create(dest, base, block_size))
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to create overlay disk.").reset().nl();
+			return ErrorNewOverlayUnable;
+		}
+		out.nl().fg(ostd::ConsoleColors::Green).p("Success. Overlay disk created:").nl();
+		out.p("  Path: ").p(dest.cpp_str()).nl();
+		out.p("  Base: ").p(base.cpp_str()).nl();
+		out.p("  Block Size: ").p(block_size).reset().nl();
+		return ErrorNoError;
+	}
+
+	i32 Tools::tool_compress_vdisk(int argc, char** argv)
+	{
+		if (argc < 4)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools compress-vdisk <virtual_disk_file> <destination_file> [block_size]").reset().nl();
+			return ErrorCompressVDiskTooFewArgs;
+		}
+		String src = argv[2];
+		String dest = argv[3];
+		u32 block_size = hw::CompressedDiskImage::tStructure::DefaultBlockSize;
+		if (argc > 4)
+		{
+			String str_block_size = argv[4];
+			if (!str_block_size.isInt() || str_block_size.toInt() <= 0 || str_block_size.toInt() > hw::CompressedDiskImage::tStructure::MaxBlockSize)
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: [block_size] parameter must be an integer between 1 and ").p(hw::CompressedDiskImage::tStructure::MaxBlockSize).p(".").reset().nl();
+				return ErrorCompressVDiskNonIntBlockSize;
+			}
+			block_size = (u32)str_block_size.toInt();
+		}
+		auto image = hw::DiskImageLoader::open(src, true);
+		if (image == nullptr)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to load virtual disk.").reset().nl();
+			return ErrorCompressVDiskUnableToLoadVDisk;
+		}
+		if (!hw::CompressedDiskImage::create(dest, *image, block_size))
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to create compressed virtual disk.").reset().nl();
+			return ErrorCompressVDiskUnable;
+		}
+		u64 compressed_size = std::filesystem::file_size(dest.cpp_str());
+		out.nl().fg(ostd::ConsoleColors::Green).p("Success. Compressed virtual disk created:").nl();
+		out.p("  Source: ").p(src.cpp_str()).nl();
+		out.p("  Path: ").p(dest.cpp_str()).nl();
+		out.p("  Block Size: ").p(block_size).nl();
+		out.p("  Size: ").p(image->getSize()).p(" -> ").p(compressed_size).p(" bytes").reset().nl();
+		return ErrorNoError;
+	}
+
+	i32 Tools::tool_decompress_vdisk(int argc, char** argv)
+	{
+		if (argc < 4)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: too few arguments.").nl();
+			out.fg(ostd::ConsoleColors::Red).p("  Usage: ./dtools decompress-vdisk <virtual_disk_file> <destination_file>").reset().nl();
+			return ErrorDecompressVDiskTooFewArgs;
+		}
+		String src = argv[2];
+		String dest = argv[3];
+		auto image = hw::DiskImageLoader::open(src, true);
+		if (image == nullptr)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to load virtual disk.").reset().nl();
+			return ErrorDecompressVDiskUnableToLoadVDisk;
+		}
+		std::ofstream rf(dest.cpp_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!rf)
+		{
+			out.fg(ostd::ConsoleColors::Red).p("Error: Unable to create destination file.").reset().nl();
+			return ErrorDecompressVDiskUnable;
+		}
+		ostd::ByteStream chunk(0x100000);
+		for (u64 addr = 0; addr < image->getSize(); addr += chunk.size())
+		{
+			u32 size = std::min<u64>(chunk.size(), image->getSize() - addr);
+			if (!image->readBytes(addr, size, &chunk[0]) || !rf.write((const char*)(&chunk[0]), size))
+			{
+				out.fg(ostd::ConsoleColors::Red).p("Error: Unable to decompress virtual disk.").reset().nl();
+				return ErrorDecompressVDiskUnable;
+			}
+		}
+		rf.close();
+		out.nl().fg(ostd::ConsoleColors::Green).p("Success. Virtual disk decompressed:").nl();
+		out.p("  Source: ").p(src.cpp_str()).nl();
+		out.p("  Path: ").p(dest.cpp_str()).nl();
+		out.p("  Size: ").p(image->getSize()).reset().nl();
+		return ErrorNoError;
+	}
+
 	void Tools::print_application_help(void)
 	{
 		out.nl().fg(ostd::ConsoleColors::Yellow).p("List of available tools:").nl().nl();
@@ -534,10 +1080,28 @@ namespace dragon
 		out.p("    <data_file>                  Path to the source binary file.").nl();
 		out.p("    <destination_address>        Destination address on the Virtual Disk.").nl().nl();
 
-		out.fg(ostd::ConsoleColors::Blue).p("new-vdisk <destination_file> <size_in_bytes>").nl();
+		out.fg(ostd::ConsoleColors::Blue).p("new-vdisk <destination_file> <size_in_bytes> [--preallocate]").nl();
 		out.fg(ostd::ConsoleColors::Green).p("The <new-vdisk> tool is used to create a new Virtual Disk File.").nl();
 		out.p("    <destination_file>           Path of the destination Virtual Disk file to be created.").nl();
-		out.p("    <size_in_bytes>              Size of the new Virtual Disk file, in bytes .").nl().nl();
+		out.p("    <size_in_bytes>              Size of the new Virtual Disk file, in bytes (max 4294967296).").nl();
+		out.p("    --preallocate (optional)     Reserve all the space on the host instead of creating a sparse file.").nl().nl();
+
+		out.fg(ostd::ConsoleColors::Blue).p("new-overlay <destination_file> <base_virtual_disk_file> [block_size]").nl();
+		out.fg(ostd::ConsoleColors::Green).p("The <new-overlay> tool is used to create a copy-on-write Virtual Disk on top of an existing one.").nl();
+		out.p("    <destination_file>           Path of the overlay file to be created. Only blocks written by the VM are stored here.").nl();
+		out.p("    <base_virtual_disk_file>     Path to the read-only base Virtual Disk (can be another overlay).").nl();
+		out.p("    [block_size] (optional)      Copy-on-write granularity, in bytes (default 4096).").nl().nl();
+
+		out.fg(ostd::ConsoleColors::Blue).p("compress-vdisk <virtual_disk_file> <destination_file> [block_size]").nl();
+		out.fg(ostd::ConsoleColors::Green).p("The <compress-vdisk> tool is used to convert a Virtual Disk into a compressed, read-only Virtual Disk.").nl();
+		out.p("    <virtual_disk_file>          Path to the source Virtual Disk file (raw, overlay or compressed).").nl();
+		out.p("    <destination_file>           Path of the compressed Virtual Disk file to be created.").nl();
+		out.p("    [block_size] (optional)      Size of each independently compressed block, in bytes (default 16384).").nl().nl();
+
+		out.fg(ostd::ConsoleColors::Blue).p("decompress-vdisk <virtual_disk_file> <destination_file>").nl();
+		out.fg(ostd::ConsoleColors::Green).p("The <decompress-vdisk> tool is used to convert any Virtual Disk back into a plain Virtual Disk file.").nl();
+		out.p("    <virtual_disk_file>          Path to the source Virtual Disk file.").nl();
+		out.p("    <destination_file>           Path of the plain Virtual Disk file to be created.").nl().nl();
 
 		out.fg(ostd::ConsoleColors::Blue).p("read-dpt <virtual_disk_file>").nl();
 		out.fg(ostd::ConsoleColors::Green).p("The <read-dpt> tool is used to read the partition table of a Virtual Disk File.").nl();
@@ -551,6 +1115,26 @@ namespace dragon
 		out.p("    -l (optional)                Used to specify the partition's label.").nl();
 		out.p("    -f (optional)                Used to specify one single flag for the partition. Use multiple -f parameters for multiple flags.").nl().nl();
 
+		out.fg(ostd::ConsoleColors::Blue).p("build-image <manifest_file> [destination_file]").nl();
+		out.fg(ostd::ConsoleColors::Green).p("The <build-image> tool is used to build a complete Virtual Disk (DPT-BLOCK and binaries) from a manifest, in one pass.").nl();
+		out.p("    <manifest_file>              Path to the manifest. One <key = value> per line, # for comments:").nl();
+		out.p("                                   size = BYTES                          Size of the Virtual Disk.").nl();
+		out.p("                                   output = FILE                         Destination Virtual Disk file.").nl();
+		out.p("                                   include = DIRECTORY                   Include directory for assembled sources.").nl();
+		out.p("                                   partition = SIZE, LABEL [, FLAG ...]  DPT partition (- for no label).").nl();
+		out.p("                                   binary = FILE @ ADDRESS               .dss sources are assembled, other files copied.").nl();
+		out.p("    [destination_file] (optional) Overrides the <output> entry of the manifest.").nl().nl();
+
+		out.fg(ostd::ConsoleColors::Blue).p("disk-trace <trace_file>").nl();
+		out.fg(ostd::ConsoleColors::Green).p("The <disk-trace> tool is used to summarize a disk I/O trace recorded by the VM (see <disk_trace_file> in the machine config).").nl();
+		out.p("    <trace_file>                 Path to the trace file.").nl().nl();
+
+		out.fg(ostd::ConsoleColors::Blue).p("fb-view <shm_name> [--snapshot <image_file>] [--watch <seconds>]").nl();
+		out.fg(ostd::ConsoleColors::Green).p("The <fb-view> tool is used to read the framebuffer exported by a running VM (see <framebuffer_shm> in the machine config).").nl();
+		out.p("    <shm_name>                   Name of the shared-memory segment.").nl();
+		out.p("    --snapshot (optional)        Save the current frame as a PPM image.").nl();
+		out.p("    --watch (optional)           Print the frame counter and frame rate once per second, for <seconds> seconds.").nl().nl();
+
 		out.fg(ostd::ConsoleColors::Blue).p("print-disassembly [-d <disassembly_directory>] | [-f <disassembly_file>]").nl();
 		out.fg(ostd::ConsoleColors::Green).p("The <print-disassembly> tool is used to parse and print disassembly tables.").nl();
 		out.p("    <disassembly_directory>      Path to the directory containing the disassembly files to parse. (Used only for -d option)").nl();
@@ -574,4 +1158,17 @@ namespace dragon
 		outTool = tool;
 		return ErrorNoError;
 	}
+
+	bool Tools::parse_unsigned(String str, u64 maxValue, u64& outValue)
+	{
+		str.trim();
+		//Anything longer cannot be a valid size or address and might not fit in toInt()'s i64
+		if (!str.isInt() || str.startsWith("-") || str.len() > 16)
+			return false;
+		i64 value = str.toInt();
+		if (value < 0 || (u64)value > maxValue)
+			return false;
+		outValue = (u64)value;
+		return true;
+	}
 }
@@ -10,17 +10,33 @@ namespace dragon
 	{
 		public:
 			static inline ostd::ConsoleOutputHandler& output(void) { return out; }
-			static bool createVirtualHardDrive(u32 sizeInBytes, const String& dataFilePath);
+			static bool createVirtualHardDrive(u64 sizeInBytes, const String& dataFilePath, bool preallocate = false);
 			static i32 execute(int argc, char** argv);
 
+		private: struct tDPTPartition
+		{
+			u32 size { 0 };
+			u32 address { 0 };
+			std::vector<u8> flags;
+			String label { "" };
+		};
+
 		private:
 			static i32 tool_new_virtual_disk(int argc, char** argv);
 			static i32 tool_load_binary(int argc, char** argv);
 			static i32 tool_read_dpt(int argc, char** argv);
 			static i32 tool_new_dpt(int argc, char** argv);
 			static i32 tool_print_disassembly(int argc, char** argv);
+			static i32 tool_new_overlay(int argc, char** argv);
+			static i32 tool_compress_vdisk(int argc, char** argv);
+			static i32 tool_decompress_vdisk(int argc, char** argv);
+			static i32 tool_build_image(int argc, char** argv);
+			static i32 tool_disk_trace(int argc, char** argv);
+			static i32 tool_framebuffer_view(int argc, char** argv);
 			static void print_application_help(void);
 			static i32 get_tool(int argc, char** argv, String& outTool);
+			static ostd::ByteStream build_dpt_block(std::vector<tDPTPartition>& partitions);
+			static bool parse_unsigned(String str, u64 maxValue, u64& outValue);
 
 		private:
 			inline static ostd::ConsoleOutputHandler out;
@@ -55,6 +71,35 @@ namespace dragon
 			inline static constexpr i32 ErrorPrintDisassemblyTooFewArgs = 22;
 			inline static constexpr i32 ErrorPrintDisassemblyInvalidFile = 23;
 			inline static constexpr i32 ErrorPrintDisassemblyInvalidArg = 24;
+			inline static constexpr i32 ErrorNewOverlayTooFewArgs = 25;
+			inline static constexpr i32 ErrorNewOverlayNonIntBlockSize = 26;
+			inline static constexpr i32 ErrorNewOverlayUnable = 27;
+			inline static constexpr i32 ErrorCompressVDiskTooFewArgs = 28;
+			inline static constexpr i32 ErrorCompressVDiskNonIntBlockSize = 29;
+			inline static constexpr i32 ErrorCompressVDiskUnableToLoadVDisk = 30;
+			inline static constexpr i32 ErrorCompressVDiskUnable = 31;
+			inline static constexpr i32 ErrorDecompressVDiskTooFewArgs = 32;
+			inline static constexpr i32 ErrorDecompressVDiskUnableToLoadVDisk = 33;
+			inline static constexpr i32 ErrorDecompressVDiskUnable = 34;
+			inline static constexpr i32 ErrorNewVDiskInvalidSize = 35;
+			inline static constexpr i32 ErrorNewVDiskUnknownOption = 36;
+			inline static constexpr i32 ErrorBuildImageTooFewArgs = 37;
+			inline static constexpr i32 ErrorBuildImageInvalidManifest = 38;
+			inline static constexpr i32 ErrorBuildImageAssemblyFailed = 39;
+			inline static constexpr i32 ErrorBuildImageUnableToLoadDataFile = 40;
+			inline static constexpr i32 ErrorBuildImageDiskOverflow = 41;
+			inline static constexpr i32 ErrorBuildImageOverlap = 42;
+			inline static constexpr i32 ErrorBuildImageUnable = 43;
+			inline static constexpr i32 ErrorDiskTraceTooFewArgs = 44;
+			inline static constexpr i32 ErrorDiskTraceInvalidFile = 45;
+			inline static constexpr i32 ErrorFramebufferViewTooFewArgs = 46;
+			inline static constexpr i32 ErrorFramebufferViewInvalidArg = 47;
+			inline static constexpr i32 ErrorFramebufferViewUnableToOpen = 48;
+			inline static constexpr i32 ErrorFramebufferViewUnableToSave = 49;
+
+			inline static constexpr u64 MaxVirtualDiskSize = 0x100000000;
+			inline static constexpr u64 PreallocateChunkSize = 0x100000;
+			inline static constexpr u32 SmallDiskRequestBytes = 512;
 
 	};
 }